@@ -5,6 +5,7 @@
 #include "enums.h"
 #include "pos.h"
 #include "piece.h"
+#include "gameconfig.h"
 #include <string>
 #include <utility>
 
@@ -18,8 +19,25 @@ struct Action {
         return Action{p, ActionType::Move, src, dst};
     }
 
-    static Action drop(Piece p, uint8_t posInReserve, Pos dst) {
-        return Action{p, ActionType::Drop, Pos{posInReserve}, dst};
+    // drops are keyed by the piece type only, src is unused
+    static Action drop(Piece p, Pos dst) {
+        return Action{p, ActionType::Drop, Pos{0}, dst};
+    }
+
+    bool operator==(const Action& other) const {
+        return p == other.p && type == other.type && src == other.src && dst == other.dst;
+    }
+
+    // 16 bit encoding : piece on 4 bits, src and dst on 5 bits each, then the type
+    // 0 never encodes an action since the piece is never empty
+    static_assert(GameConfig::squares <= 32);
+
+    constexpr uint16_t pack() const {
+        return p.id() | (src.idx() << 4) | (dst.idx() << 9) | (type << 14);
+    }
+
+    static constexpr Action unpack(uint16_t packed) {
+        return Action{Piece(int(packed & 0xF)), ActionType((packed >> 14) & 0x1), Pos((packed >> 4) & 0x1F), Pos((packed >> 9) & 0x1F)};
     }
 
 
@@ -31,18 +49,16 @@ struct Action {
         if(type == Move) {
             message += "moves " + (std::string()+(char)p.toChar()) + " from " + src.toString() + " to " + dst.toString();
         } else {
-            message += "drops " + (std::string()+(char)p.toChar()) + " from position " + std::to_string((int)src.pos) + " on " + dst.toString();
+            message += "drops " + (std::string()+(char)p.toChar()) + " on " + dst.toString();
         }
         return message;
     }
 };
 
-using aspair = std::pair<Action, double>;
-
 struct ActionSet {
 
     using value_type = Action;
-    using storage = static_vector<value_type, 64>;
+    using storage = static_vector<value_type, GameConfig::maxActions>;
 
     storage actions;
 
@@ -4,60 +4,176 @@
 #include "gamestate.h"
 #include "stateanalysis.h"
 #include "action.h"
+#include "orderingheuristics.h"
 #include "staticvector.h"
+#include "minimax/score.h"
 #include <utility>
 #include <algorithm>
+#include <limits>
 
+// Staged move picker : yields the hint first, then winning captures, quiet moves,
+// drops and finally losing captures. A stage is only generated and scored when
+// the previous one is exhausted, and moves are selected one at a time, so a
+// cutoff on an early move never pays for the remaining stages.
+// Quiet moves and drops are also ranked by the heuristics of the search, if given.
 struct ActionOrdering {
 
-    ActionSet* const actions;
-    static_vector<double, 64> scores;
+    using Heuristics = OrderingHeuristics;
 
-    template<typename GameState>
-    ActionOrdering(ActionSet* actions, const GameState& state) :
-        actions(actions)
+    enum Stage {
+        HintStage,
+        GenerateCaptures,
+        WinningCaptures,
+        GenerateQuiets,
+        Quiets,
+        GenerateDrops,
+        Drops,
+        LosingCaptures,
+        Done
+    };
+
+    ActionOrdering(const GameState& state, const Action* hint = nullptr, const Heuristics* heuristics = nullptr, int ply = 0, const Action* previous = nullptr) :
+        state(state),
+        hint(hint),
+        heuristics(heuristics),
+        ply(ply),
+        previous(previous),
+        capturesOnly(false),
+        stage(hint ? HintStage : GenerateCaptures),
+        current(0),
+        currentCapture(0)
+    { }
+
+    // only yields captures, winning ones first, for quiescence searches
+    struct Captures {};
+
+    ActionOrdering(const GameState& state, Captures) :
+        ActionOrdering(state)
     {
-        StateAnalysis analyzer(state.board, state.reserve0, state.reserve1);
-        scores.clear();
-        scores.reserve(actions->size());
-        for(const Action& action : *actions) {
-            if(action.p.color() == P0) scores.push_back(score0(action, state, analyzer));
-            if(action.p.color() == P1) scores.push_back(score1(action, state, analyzer));
+        capturesOnly = true;
+    }
+
+    // writes the next action to try, returns false when all actions have been yielded
+    bool next(Action& action) {
+        while(true) {
+            switch(stage) {
+                case HintStage: {
+                    stage = GenerateCaptures;
+                    if(state.checkAction(*hint)) {
+                        action = *hint;
+                        return true;
+                    }
+                    hint = nullptr;
+                    break;
+                }
+                case GenerateCaptures: {
+                    state.fillCaptures(&captures);
+                    scoreAll(captures, captureScores, false);
+                    currentCapture = 0;
+                    stage = WinningCaptures;
+                    break;
+                }
+                case WinningCaptures: {
+                    if(selectBest(captures, captureScores, currentCapture, 0, action)) return true;
+                    stage = (capturesOnly ? LosingCaptures : GenerateQuiets);
+                    break;
+                }
+                case GenerateQuiets: {
+                    state.fillQuietMoves(&others);
+                    scoreAll(others, otherScores, true);
+                    current = 0;
+                    stage = Quiets;
+                    break;
+                }
+                case Quiets: {
+                    if(selectBest(others, otherScores, current, lowest, action)) return true;
+                    stage = GenerateDrops;
+                    break;
+                }
+                case GenerateDrops: {
+                    state.fillDrops(&others);
+                    scoreAll(others, otherScores, true);
+                    current = 0;
+                    stage = Drops;
+                    break;
+                }
+                case Drops: {
+                    if(selectBest(others, otherScores, current, lowest, action)) return true;
+                    stage = LosingCaptures;
+                    break;
+                }
+                case LosingCaptures: {
+                    if(selectBest(captures, captureScores, currentCapture, lowest, action)) return true;
+                    stage = Done;
+                    break;
+                }
+                case Done: {
+                    return false;
+                }
+            }
         }
     }
 
-    void sort() {
-        ActionSet& actionset = *actions;
-        static_vector<aspair, 64> actionScores;
+private:
 
-        const size_t size = scores.size();
-        actionScores.clear();
-        actionScores.reserve(size);
-        for(size_t i = 0; i < size; ++i) {
-            actionScores.emplace_back(std::make_pair(actionset[i], scores[i]));
-        }
-        std::sort(actionScores.begin(), actionScores.end(), [](const aspair& a, const aspair& b) { return a.second > b.second; });
-        for(size_t i = 0; i < size; ++i) {
-            actionset[i] = actionScores[i].first;
+    static constexpr score_t lowest = std::numeric_limits<score_t>::min();
+
+    const GameState& state;
+    const Action* hint;
+    const Heuristics* heuristics;
+    int ply;
+    const Action* previous;
+    bool capturesOnly;
+    Stage stage;
+
+    ActionSet captures;
+    static_vector<score_t, ActionSet::storage::capacity> captureScores;
+    ActionSet others;
+    static_vector<score_t, ActionSet::storage::capacity> otherScores;
+    unsigned int current;
+    unsigned int currentCapture;
+
+    void scoreAll(const ActionSet& actions, static_vector<score_t, ActionSet::storage::capacity>& scores, bool quiet) {
+        scores.clear();
+        scores.reserve(actions.size());
+        for(const Action& action : actions) {
+            if(action.p.color() == P0) scores.push_back(score0(action, state, state.analysis));
+            if(action.p.color() == P1) scores.push_back(score1(action, state, state.analysis));
+            if(quiet && heuristics) scores.back() += heuristics->bonus(action, ply, previous);
         }
     }
 
-private:
+    // moves the best remaining action scoring at least threshold to position next and yields it
+    bool selectBest(ActionSet& actions, static_vector<score_t, ActionSet::storage::capacity>& scores, unsigned int& next, score_t threshold, Action& action) {
+        while(next < actions.size()) {
+            unsigned int best = next;
+            for(unsigned int i = next+1; i < actions.size(); ++i) {
+                if(scores[i] > scores[best]) best = i;
+            }
+            if(scores[best] < threshold) return false;
+            std::swap(actions[next], actions[best]);
+            std::swap(scores[next], scores[best]);
+            action = actions[next++];
+            if(hint && action == *hint) continue;
+            return true;
+        }
+        return false;
+    }
 
-    static constexpr std::array<double, NB_PIECE_TYPE> pieceValue {
-        0.0,     // NoType,
-        1000.0,  // King,
-        50.0,    // Rook,
-        50.0,    // Bishop,
-        10.0,    // Pawn,
-        30.0,    // Queen,
+    static constexpr std::array<score_t, NB_PIECE_TYPE> pieceValue {
+        0,     // NoType,
+        1000,  // King,
+        50,    // Rook,
+        50,    // Bishop,
+        10,    // Pawn,
+        30,    // Queen,
     };
 
     template<typename GameState>
-    static double score0(const Action& action, const GameState& state, const StateAnalysis& analyzer) {
-        double score = 0;
+    static score_t score0(const Action& action, const GameState& state, const StateAnalysis& analyzer) {
+        score_t score = 0;
         if(analyzer.controlled1[action.dst.idx()]) {
-            double val = pieceValue[action.p.type()];
+            score_t val = pieceValue[action.p.type()];
             score -= val;
             if(!analyzer.controlled0[action.dst.idx()]) score -= val;
         }
@@ -66,10 +182,10 @@ private:
     }
 
     template<typename GameState>
-    static double score1(const Action& action, const GameState& state, const StateAnalysis& analyzer) {
-        double score = 0;
+    static score_t score1(const Action& action, const GameState& state, const StateAnalysis& analyzer) {
+        score_t score = 0;
         if(analyzer.controlled0[action.dst.idx()]) {
-            double val = pieceValue[action.p.type()];
+            score_t val = pieceValue[action.p.type()];
             score -= val;
             if(!analyzer.controlled1[action.dst.idx()]) score -= val;
         }
@@ -1,64 +1,70 @@
 #ifndef AGENT_H
 #define AGENT_H
 
+#include "gamestate.h"
 #include "stateanalysis.h"
 #include "enums.h"
 #include "minimax/logger.h"
+#include "minimax/score.h"
 #include <algorithm>
 #include <array>
-#include <limits>
-#include <cmath>
 
 struct Agent {
 
     struct score {
-        double s0 = 0; // estimated score of p0
-        double s1 = 0; // estimated score of p1
-        double p = 0;  // penalty
+        score_t s0 = 0; // estimated score of p0
+        score_t s1 = 0; // estimated score of p1
+        score_t p = 0;  // penalty
 
-        double value(Color player) const { return (player == Color::P0 ? (s0-s1) : (s1-s0))+p; }
+        score_t value(Color player) const { return (player == Color::P0 ? (s0-s1) : (s1-s0))+p; }
     };
 
     size_t nbEvals;
 
-    // scores
-    std::array<double, NB_PIECE_TYPE> boardValue;
-    std::array<double, NB_PIECE_TYPE> reserveValue;
-    double occupiedValue;
-    double controlledValue;
-    double disputedValue;
-    double dangerValue;
-    double kingAttackedValue;
-    double kingEscapesValue;
-    double kingDistanceValue;
-    double kingDeadValue;
-    double endGamePenalty;
-    double drawPenalty;
+    // scores, in hundredths of a unit
+    std::array<score_t, NB_PIECE_TYPE> boardValue;
+    std::array<score_t, NB_PIECE_TYPE> reserveValue;
+    score_t occupiedValue;
+    score_t controlledValue;
+    score_t disputedValue;
+    score_t dangerValue;
+    score_t kingAttackedValue;
+    score_t kingEscapesValue;
+    score_t kingDistanceValue;
+    score_t kingDeadValue;
+    score_t endGamePenalty;
+    score_t drawPenalty;
 
     Agent() : 
         nbEvals(0),
-        boardValue{0, 0, 5, 3, 1, 4},
-        reserveValue{0, 1000, 10, 6, 2, 0},
-        occupiedValue(1),
-        controlledValue(0.5),
+        boardValue{0, 0, 500, 300, 100, 400},
+        reserveValue{0, 100000, 1000, 600, 200, 0},
+        occupiedValue(100),
+        controlledValue(50),
         disputedValue(0),
-        dangerValue(-0.5),
-        kingAttackedValue(-5),
-        kingEscapesValue(1),
-        kingDistanceValue(1),
-        kingDeadValue(-std::numeric_limits<double>::infinity()),
-        endGamePenalty(-500),
-        drawPenalty(-5000)
+        dangerValue(-50),
+        kingAttackedValue(-500),
+        kingEscapesValue(100),
+        kingDistanceValue(100),
+        kingDeadValue(Score::loss),
+        endGamePenalty(-50000),
+        drawPenalty(-500000)
     { }
 
     ~Agent() {
         Logger::log(Verb::Dev, [&](){ return "Agent has evaluated : " + std::to_string(nbEvals) + " positions"; });
     }
 
+    // material swing of capturing a piece : it leaves the board and joins the reserve demoted
+    score_t captureValue(Piece p) const {
+        const PieceType pt = p.type();
+        return boardValue[pt] + reserveValue[pt == Queen ? Pawn : pt];
+    }
+
     score evaluate(const GameState& state) {
         ++nbEvals;
 
-        StateAnalysis sa(state.board, state.reserve0, state.reserve1);
+        const StateAnalysis& sa = state.analysis;
 
         score s;
         s.s0 += occupiedValue * sa.nbOccupied0();
@@ -98,7 +98,7 @@ struct AllowedMove {
 
 };
 
-#ifndef NDEBUG
+#if !defined(NDEBUG) && defined(BOARD_4X3)
 namespace {
 
     using move_set = static_vector<Pos, 8>;
@@ -4,32 +4,34 @@
 #include "pos.h"
 #include "piece.h"
 #include "enums.h"
+#include "gamelogic.h"
+#include "zobrist.h"
 #include <algorithm>
 #include <cstring>
 #include <cassert>
 
 struct Board {
 
-    static constexpr int rows = 4;
-    static constexpr int cols = 3;
+    static constexpr int rows = GameConfig::rows;
+    static constexpr int cols = GameConfig::cols;
+
+    using mask = mask_t;
 
     Board() :
-        k0(1),
-        k1(10),
-        pieces({
-            // it's backwards in the initializer...
-            Piece(Bishop, P0), Piece(King, P0), Piece(Rook, P0),
-            Piece(),           Piece(Pawn, P0), Piece(),
-            Piece(),           Piece(Pawn, P1), Piece(),
-            Piece(Rook, P1),   Piece(King, P1), Piece(Bishop, P1),
-        })
+        Board(GameConfig::startPosition)
     { }
 
-    Board(const char* board) {
+    Board(const char* board) :
+        masks(),
+        occupancy(),
+        zobrist(0),
+        pieces()
+    {
         assert(std::strlen(board) == rows*cols);
         for(size_t i = 0; i < rows*cols; ++i) {
             pieces[i] = Piece(board[i]);
         }
+        computeMasks();
     }
 
     const Piece* begin() const noexcept { return pieces.begin(); }
@@ -47,35 +49,75 @@ struct Board {
     }
     
     void set(uint8_t i, Piece p) {
-        if(pieces[i].type() == PieceType::King) {
-            if(pieces[i].color() == Color::P0) k0 = Pos(-1);
-            if(pieces[i].color() == Color::P1) k1 = Pos(-1);
+        const Piece old = pieces[i];
+        if(!old.empty()) {
+            masks[old.id()].reset(i);
+            occupancy[old.color()].reset(i);
         }
         pieces[i] = p;
-        if(p.type() == PieceType::King) {
-            if(p.color() == Color::P0) k0 = Pos(i);
-            if(p.color() == Color::P1) k1 = Pos(i);
+        if(!p.empty()) {
+            masks[p.id()].set(i);
+            occupancy[p.color()].set(i);
         }
+        zobrist ^= Zobrist::square(i, old.id()) ^ Zobrist::square(i, p.id());
+    }
+
+    // hash of the pieces on the board only, maintained by set
+    hash_t hash() const { return zobrist; }
+
+    hash_t computeHash() const {
+        hash_t val = 0;
+        for(uint8_t i = 0; i < rows*cols; ++i) val ^= Zobrist::square(i, pieces[i].id());
+        return val;
     }
 
     bool operator==(const Board& other) const {
-        return ((k0 == other.k0) & (k1 == other.k1)) && pieces == other.pieces;
+        return pieces == other.pieces;
     }
 
-    constexpr uint8_t king0() const { return k0.idx() < rows*cols ? k0.idx() : 0; }
-    constexpr uint8_t king1() const { return k1.idx() < rows*cols ? k1.idx() : 0; }
+    // squares holding the given piece
+    constexpr mask pieceMask(Piece p) const { return masks[p.id()]; }
+
+    // squares holding a piece of the given player
+    constexpr mask occupied(Color c) const { return occupancy[c]; }
+
+    constexpr mask occupied() const { return occupancy[P0] | occupancy[P1]; }
+
+    constexpr mask empty() const { return ~occupied() & MoveMasks::board; }
+
+    constexpr uint8_t king0() const { return kingPos(P0); }
+    constexpr uint8_t king1() const { return kingPos(P1); }
 
 private:
 
+    void computeMasks() {
+        std::fill(masks.begin(), masks.end(), mask());
+        std::fill(occupancy.begin(), occupancy.end(), mask());
+        for(uint8_t i = 0; i < rows*cols; ++i) {
+            const Piece p = pieces[i];
+            if(p.empty()) continue;
+            masks[p.id()].set(i);
+            occupancy[p.color()].set(i);
+        }
+        zobrist = computeHash();
+    }
+
+    constexpr uint8_t kingPos(Color c) const {
+        const mask king = masks[Piece(King, c).id()];
+        return king.any() ? king.first() : 0;
+    }
+
     void check() const {
-        if(k0.idx() < rows*cols) assert(pieces[k0.idx()].type() == PieceType::King);
-        if(k1.idx() < rows*cols) assert(pieces[k1.idx()].type() == PieceType::King);
+        assert((masks[Piece(King, P0).id()] & ~occupancy[P0]).val == 0);
+        assert((masks[Piece(King, P1).id()] & ~occupancy[P1]).val == 0);
     }
 
-    Pos k0;
-    Pos k1;
+    // masks[p.id()] holds the squares of piece p
+    std::array<mask, NB_PLAYERS*NB_PIECE_TYPE> masks;
+    std::array<mask, NB_PLAYERS> occupancy;
+    hash_t zobrist;
     std::array<Piece, rows*cols> pieces;
 
 };
 
-#endif
\ No newline at end of file
+#endif
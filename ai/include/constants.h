@@ -7,5 +7,8 @@ static constexpr unsigned int NB_PLAYERS = 2;
 
 static constexpr unsigned int MAX_TURNS = 50;
 
+// turns of games started from a position given as strings, the longest a GameState plays
+static constexpr unsigned int MAX_GAME_TURNS = 150;
+
 
 #endif
\ No newline at end of file
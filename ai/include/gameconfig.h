@@ -2,11 +2,50 @@
 #define GAMECONFIG_H
 
 #include "enums.h"
+#include <cstdint>
+#include <type_traits>
 
-struct GameConfig {
-    static constexpr unsigned int rows = 4;
-    static constexpr unsigned int cols = 3;
-    static constexpr unsigned int ressize = 7;
+// Board geometry, fixed at compile time so that every variant gets its own
+// specialized tables and mask type. Squares are numbered row by row from the
+// home row of player 0.
+template<unsigned int Rows, unsigned int Cols, unsigned int Ressize, unsigned int MaxActions>
+struct BoardGeometry {
+    static constexpr unsigned int rows = Rows;
+    static constexpr unsigned int cols = Cols;
+    static constexpr unsigned int squares = rows*cols;
+    static constexpr unsigned int ressize = Ressize;
+    static constexpr unsigned int maxActions = MaxActions;
+
+    // smallest integer holding one bit per square, at least 32 bits wide
+    using mask_value_t = std::conditional_t<(squares < 32), uint32_t, uint64_t>;
+
+    static_assert(squares < 64);
+};
+
+#if defined(BOARD_5X6)
+
+struct GameConfig : BoardGeometry<6, 5, 15, 256> {
+    static constexpr const char* startPosition =
+        "RBKBR"
+        "....."
+        ".PPP."
+        ".ppp."
+        "....."
+        "rbkbr";
 };
 
-#endif
\ No newline at end of file
+#else
+
+#define BOARD_4X3
+
+struct GameConfig : BoardGeometry<4, 3, 7, 64> {
+    static constexpr const char* startPosition =
+        "BKR"
+        ".P."
+        ".p."
+        "rkb";
+};
+
+#endif
+
+#endif
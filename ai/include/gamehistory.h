@@ -1,71 +1,88 @@
 #ifndef GAMEHISTORY_H
 #define GAMEHISTORY_H
 
-#include "gamelogic.h"
 #include "staticvector.h"
-#include "board.h"
+#include "zobrist.h"
 #include "constants.h"
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cassert>
 
+// Positions are identified by the zobrist hash of the board. A small open
+// addressing table counts how many times each hash has been pushed, so that
+// push, pop and hasDraw are all constant time. A game pushes at most one position
+// per turn besides the first, so a history holds any game; pushes past that are
+// not recorded rather than written out of bounds.
 struct GameHistory {
 
-    using board_t = Board;
+    static constexpr unsigned int maxPositions = std::max(MAX_TURNS, MAX_GAME_TURNS)+2;
+    static constexpr unsigned int tableSize = 512;
+    static constexpr unsigned int tableMask = tableSize-1;
 
-    static constexpr unsigned int nbKingPos = GameLogic::rows*GameLogic::cols;
+    static_assert((tableSize & tableMask) == 0);
+    static_assert(2*maxPositions <= tableSize);
 
-    static_vector<board_t, MAX_TURNS+2> positions;
-    std::array<uint8_t, nbKingPos*nbKingPos> countKingPos;
-    bool cached_draw;
-    bool cache_valid;
+    struct Entry {
+        hash_t key;
+        uint8_t count;
+    };
+
+    static_vector<hash_t, maxPositions> positions;
+    std::array<Entry, tableSize> table;
+    unsigned int nbRepeated; // boards that occurred at least twice
+    unsigned int nbDropped; // pushes past maxPositions, not recorded
 
 
     GameHistory() :
-        cached_draw(false),
-        cache_valid(false)
-    {
-        std::fill(countKingPos.begin(), countKingPos.end(), 0);
-    }
+        table(),
+        nbRepeated(0),
+        nbDropped(0)
+    { }
+
 
-    
-    void push(const board_t& board) {
-        positions.push_back(board);
-        ++countKingPos[board.king0()*nbKingPos+board.king1()];
-        cache_valid = false;
+    void push(hash_t key) {
+        if(positions.size() == maxPositions) {
+            ++nbDropped;
+            return;
+        }
+        positions.push_back(key);
+        Entry& e = table[find(key)];
+        e.key = key;
+        if(++e.count == 2) ++nbRepeated;
     }
 
+    // entries are released as soon as their count drops to zero : since pops
+    // come in reverse order of pushes, no live key ever probed past them
     void pop() {
-        const board_t& board = positions.back();
-        --countKingPos[board.king0()*nbKingPos+board.king1()];
+        if(nbDropped > 0) {
+            --nbDropped;
+            return;
+        }
+        Entry& e = table[find(positions.back())];
+        assert(e.count > 0);
+        if(e.count-- == 2) --nbRepeated;
         positions.pop_back();
-        cache_valid = false;
     }
 
-    bool hasDraw() {
-        if(cache_valid) return cached_draw;
-        // We only need to check if the last move was a draw
-        if(positions.begin() == positions.end()) {
-            set_cache(false);
-            return false;
-        }
-        const board_t& h = positions.back();
-        if(countKingPos[h.king0()*nbKingPos+h.king1()] < 3) {
-            set_cache(false);
-            return false;
-        }
-        unsigned int val = 0;
-        for (auto& b : positions) {
-            val += (b == h);
-        }
-        set_cache(val == 3);
-        return val == 3;
+    // We only need to check if the last move was a draw
+    bool hasDraw() const {
+        if(positions.empty() || nbDropped > 0) return false;
+        return table[find(positions.back())].count == 3;
     }
 
-    void set_cache(bool v) {
-        cached_draw = v;
-        cache_valid = true;
+    // key was pushed at least twice, one more push is a draw
+    bool repeated(hash_t key) const { return table[find(key)].count >= 2; }
+
+private:
+
+    // slot holding key, or the empty slot where it should be inserted
+    unsigned int find(hash_t key) const {
+        unsigned int i = key & tableMask;
+        while(table[i].count != 0 && table[i].key != key) i = (i+1) & tableMask;
+        return i;
     }
 
 };
 
 
-#endif
\ No newline at end of file
+#endif
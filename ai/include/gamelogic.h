@@ -5,6 +5,8 @@
 #include "enums.h"
 #include "piece.h"
 #include "gameconfig.h"
+#include "smallbitset.h"
+#include <array>
 
 struct GameLogic {
 
@@ -15,7 +17,7 @@ struct GameLogic {
     using move_sets = typename AllowedMove::move_sets;
 
     static constexpr const move_sets& moveSets(Piece piece) {
-        assert(piece.id() < rows*cols);
+        assert(piece.id() < allMoveSets.size());
         return allMoveSets[piece.id()];
     }
 
@@ -42,4 +44,54 @@ struct GameLogic {
 
 };
 
+using mask_t = SmallBitset<GameConfig::squares, GameConfig::mask_value_t>;
+
+template<typename T, unsigned int N, unsigned int... Ns>
+struct multi_array {
+    std::array< multi_array<T, Ns...>, N> array;
+
+    constexpr multi_array<T, Ns...>& operator[](uint8_t pos) { return array[pos]; }
+    constexpr const multi_array<T, Ns...>& operator[](uint8_t pos) const { return array[pos]; }
+};
+
+template<typename T, unsigned int N>
+struct multi_array<T, N> {
+    std::array<T, N> array;
+
+    constexpr T& operator[](uint8_t pos) { return array[pos]; }
+    constexpr const T& operator[](uint8_t pos) const { return array[pos]; }
+};
+
+
+template<unsigned int rows = GameConfig::rows, unsigned int cols = GameConfig::cols>
+using mask_storage = multi_array<mask_t, 2, NB_PIECE_TYPE, rows*cols>;
+
+template<unsigned int rows = GameConfig::rows, unsigned int cols = GameConfig::cols>
+constexpr mask_storage<> computeAllMasks() {
+    using mask = mask_t;
+
+    mask_storage<> result;
+    for(uint8_t player = 0; player < 2; ++player) {
+        for(uint8_t id = 0; id < NB_PIECE_TYPE; ++id) {
+            for(uint8_t pos = 0; pos < rows*cols; ++pos) {
+                Piece piece((PieceType)id, (Color)player);
+                Pos current(pos);
+                mask m;
+                for(Pos p : GameLogic::moveSet(piece, current)) m.set(p.idx());
+                result[player][id][pos] = m;
+            }
+        }
+    }
+    return result;
+}
+
+struct MoveMasks {
+
+    // allMasks[player][type][pos] : squares reachable by the piece from pos
+    static constexpr mask_storage<> allMasks = computeAllMasks();
+
+    static constexpr mask_t board = mask_t::full();
+
+};
+
 #endif
\ No newline at end of file
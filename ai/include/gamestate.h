@@ -6,8 +6,14 @@
 #include "piece.h"
 #include "reserve.h"
 #include "gamehistory.h"
+#include "stateanalysis.h"
 #include "gameconfig.h"
 #include "constants.h"
+#include "zobrist.h"
+#ifdef BOARD_4X3
+#include "packedposition.h"
+#include "positionindex.h"
+#endif
 
 #include <array>
 #include <string>
@@ -27,6 +33,8 @@ struct GameState {
     Color winner;
     uint8_t nbTurns;
     uint8_t maxTurns;
+    hash_t zobrist; // reserves and side to move part of hash()
+    StateAnalysis analysis;
 
     GameState(GameHistory* history) : 
         history(history),
@@ -36,9 +44,11 @@ struct GameState {
         currentPlayer(P0),
         winner(None),
         nbTurns(0),
-        maxTurns(MAX_TURNS)
+        maxTurns(MAX_TURNS),
+        zobrist(sideHash()),
+        analysis(board, reserve0, reserve1)
     {
-        if(history) history->push(board);
+        if(history) history->push(board.hash());
     }
 
 
@@ -54,9 +64,11 @@ struct GameState {
         currentPlayer(player),
         winner(None),
         nbTurns(0),
-        maxTurns(MAX_TURNS)
+        maxTurns(MAX_TURNS),
+        zobrist(sideHash()),
+        analysis(board, reserve0, reserve1)
     {
-        if(history) history->push(board);
+        if(history) history->push(board.hash());
         if(hasWon(P0)) winner = P0;
         if(hasWon(P1)) winner = P1;
     }
@@ -69,14 +81,63 @@ struct GameState {
         currentPlayer(player),
         winner(None),
         nbTurns(0),
-        maxTurns(150)
+        maxTurns(MAX_GAME_TURNS),
+        zobrist(sideHash()),
+        analysis(board, reserve0, reserve1)
     {
-        if(history) history->push(board);
+        if(history) history->push(board.hash());
         if(hasWon(P0)) winner = P0;
         if(hasWon(P1)) winner = P1;
     }
 
 
+#ifdef BOARD_4X3
+    // packed positions and their indices only describe the 4x3 board
+    GameState(GameHistory* history, PackedPosition packed) :
+        history(history),
+        board(),
+        reserve0(),
+        reserve1(),
+        currentPlayer((Color)packed.player()),
+        winner(None),
+        nbTurns(0),
+        maxTurns(MAX_TURNS),
+        zobrist(0),
+        analysis()
+    {
+        const UnpackedPosition pos = packed.unpack();
+        for(uint8_t i = 0; i < rows*cols; ++i) board.set(i, Piece(pos.board[i]));
+        for(uint8_t pt = King; pt <= Pawn; ++pt) {
+            for(uint8_t n = 0; n < pos.reserves[P0][pt]; ++n) reserve0.push(Piece((PieceType)pt, P0));
+            for(uint8_t n = 0; n < pos.reserves[P1][pt]; ++n) reserve1.push(Piece((PieceType)pt, P1));
+        }
+        zobrist = sideHash();
+        analysis = StateAnalysis(board, reserve0, reserve1);
+        if(history) history->push(board.hash());
+        if(reserve0.has(King)) winner = P0;
+        if(reserve1.has(King)) winner = P1;
+    }
+
+    PackedPosition pack() const {
+        UnpackedPosition pos {};
+        for(uint8_t i = 0; i < rows*cols; ++i) {
+            const Piece p = board.get(i);
+            pos.board[i] = (p.type() == NoType ? 0 : p.id());
+        }
+        for(uint8_t pt = King; pt <= Pawn; ++pt) {
+            pos.reserves[P0][pt] = reserve0.count((PieceType)pt);
+            pos.reserves[P1][pt] = reserve1.count((PieceType)pt);
+        }
+        pos.player = currentPlayer;
+        return PackedPosition::pack(pos);
+    }
+
+    // dense index of the position, see positionindex.h
+    PositionIndex::index_t index() const {
+        return PositionIndex::rank(pack());
+    }
+#endif
+
     inline std::string toString() const {
         std::string s;
         s += board.toString();
@@ -104,12 +165,14 @@ struct GameState {
         };
         std::string b;
         for(Piece p : board) b += pieceCode[p.id()];
-        std::string r0("vvvvvvvv");
-        std::string r1("vvvvvvvv");
-        for(unsigned int i = 0; i < reserve0.size; ++i) 
-            r0[i] = pieceCode[reserve0[i].id()];
-        for(unsigned int i = 0; i < reserve1.size; ++i) 
-            r1[i] = pieceCode[reserve1[i].id()];
+        std::string r0;
+        std::string r1;
+        for(uint8_t pt = 0; pt < NB_PIECE_TYPE; ++pt) {
+            r0.append(reserve0.count((PieceType)pt), pieceCode[Piece((PieceType)pt, P0).id()]);
+            r1.append(reserve1.count((PieceType)pt), pieceCode[Piece((PieceType)pt, P1).id()]);
+        }
+        r0.resize(8, 'v');
+        r1.resize(8, 'v');
 
         std::string s = b + " " + r0 + " " + r1;
         return s;
@@ -126,11 +189,13 @@ struct GameState {
         for(uint8_t i = rows; i --> 0;) {
             s += '\n' + std::to_string(i+1) + ' ';
             for(uint8_t j = 0; j < cols; ++j) {
-                s += board.get(3*i+j).toChar();
+                s += board.get(cols*i+j).toChar();
             }
         }
         s += '\n';
-        s += "  ABC\n";
+        s += "  ";
+        for(uint8_t j = 0; j < cols; ++j) s += char('A'+j);
+        s += '\n';
         s += "-----------------\n";
         s += (currentPlayer == P0 ? "> " : "  ");
         s += "Player A | ";
@@ -142,32 +207,95 @@ struct GameState {
 
     void fillAllowedActions(ActionSet*) const;
 
+    // Subsets of fillAllowedActions, used to generate moves in stages
+    void fillCaptures(ActionSet*) const;
+
+    // read from the analysis, for the player to move
+    bool canCapture() const { return currentPlayer == P0 ? analysis.canCapture0() : analysis.canCapture1(); }
+    bool isKingAttacked() const { return currentPlayer == P0 ? analysis.isKingAttacked0() : analysis.isKingAttacked1(); }
+    void fillQuietMoves(ActionSet*) const;
+    void fillDrops(ActionSet*) const;
+
+    // Zobrist key of the position : the board keeps its part, and the reserves and side
+    // to move part is maintained incrementally by move, drop and swapPlayer
+    hash_t hash() const { return board.hash() ^ zobrist; }
+
+    hash_t computeHash() const {
+        return board.computeHash() ^ sideHash();
+    }
+
+    hash_t sideHash() const {
+        return reserve0.hash() ^ reserve1.hash() ^ Zobrist::player(currentPlayer);
+    }
+
+    // Everything needed to take back an action applied in place
+    struct Undo {
+        Action action;
+        Piece moved;         // piece that left the source square, before promotion
+        Piece captured;      // piece that stood on the destination square
+        Color winner;
+        hash_t zobrist;
+    };
+
     bool apply(Action action) {
+        Undo undo;
+        return apply(action, undo);
+    }
+
+    bool apply(Action action, Undo& undo) {
         assert(winner == None);
         assert(checkAction(action));
+        undo.action = action;
+        undo.captured = board.get(action.dst.idx());
+        undo.winner = winner;
+        undo.zobrist = zobrist;
         bool res = false;
         if(action.type == Move) {
+            undo.moved = board.get(action.src.idx());
             res = move(action.p, action.src, action.dst);
         }
         else {
-            res = drop(action.p, action.src, action.dst);
+            undo.moved = action.p;
+            res = drop(action.p, action.dst);
         }
         if(res) {
-            if(history) history->push(board);
-            // player wins if he ate king, so they win if a king is at the top of their reserve
+            assert(hash() == computeHash());
+            assert(board.hash() == board.computeHash());
+            assert(analysis == StateAnalysis(board, reserve0, reserve1));
+            if(history) history->push(board.hash());
+            // player wins if he ate king
             assert(action.p.color() != None);
-            if(action.p.color() == P0) {
-                if(reserve0.size > 0 && reserve0[reserve0.size-1].type() == King) winner = P0;
-            } else {
-                if(reserve1.size > 0 && reserve1[reserve1.size-1].type() == King) winner = P1;
-            }
+            if(undo.captured.type() == King) winner = action.p.color();
         }
         return res;
     }
 
-    void revert() {
+    void undo(const Undo& undo) {
         if(history) history->pop();
-        winner = None;
+        winner = undo.winner;
+        currentPlayer = (currentPlayer == P0 ? P1 : P0);
+        --nbTurns;
+        const Action& action = undo.action;
+        const Color c = action.p.color();
+        if(action.type == Move) {
+            if(!undo.captured.empty()) {
+                Piece captured = undo.captured;
+                captured.demote();
+                if(c == P0) analysis.removeReserve(reserve0.pop(captured.type()));
+                else analysis.removeReserve(reserve1.pop(captured.type()));
+            }
+            setSquare(action.dst.idx(), undo.captured);
+            setSquare(action.src.idx(), undo.moved);
+        }
+        else {
+            setSquare(action.dst.idx(), Piece());
+            if(c == P0) reserve0.push(undo.moved);
+            else reserve1.push(undo.moved);
+            analysis.addReserve(undo.moved);
+        }
+        zobrist = undo.zobrist;
+        assert(hash() == computeHash());
+        assert(analysis == StateAnalysis(board, reserve0, reserve1));
     }
     
 public:
@@ -177,19 +305,34 @@ public:
             return checkMove(action.p, action.src, action.dst);
         }
         else {
-            return checkDrop(action.p, action.src, action.dst);
+            return checkDrop(action.p, action.dst);
         }
     }
 
     bool checkMove(Piece p, Pos a, Pos b) const;
-    bool checkDrop(Piece p, Pos res, Pos dst) const;
+    bool checkDrop(Piece p, Pos dst) const;
 
     bool allowedMove(Piece p, Pos a, Pos b) const;
-    bool allowedDrop(Piece p, uint8_t& posInReserve, Pos a) const;
+    bool allowedDrop(Piece p, Pos a) const;
     bool move(Piece p, Pos a, Pos b);
-    bool drop(Piece p, Pos res, Pos dst);
+    bool drop(Piece p, Pos dst);
     static bool allowedOffset(Piece p, Pos a, Pos b);
 
+private:
+
+    void appendMoves(ActionSet* actions, mask_t allowedTargets) const;
+    void appendDrops(ActionSet* actions) const;
+
+    // board update that keeps the analysis in sync
+    void setSquare(uint8_t i, Piece p) {
+        const Piece old = board.get(i);
+        if(!old.empty()) analysis.remove(old, i);
+        board.set(i, p);
+        if(!p.empty()) analysis.add(p, i);
+    }
+
+public:
+
     inline bool hasWon(Color player) const { return winner == player; }
 
     inline bool hasLost(Color player) const {
@@ -210,11 +353,45 @@ public:
         return (nbTurns == maxTurns) || (history && history->hasDraw());
     }
 
+    // the current board occurred before, one more visit is a draw
+    bool isRepeated() const {
+        return history && history->repeated(board.hash());
+    }
+
+    // boards of the history that occurred at least twice
+    unsigned int nbRepetitions() const {
+        return history ? history->nbRepeated : 0;
+    }
+
     void swapPlayer() {
+        zobrist ^= Zobrist::player(P1);
         currentPlayer = (currentPlayer == P0 ? P1 : P0);
         ++nbTurns;
     }
 
+    // The side to move gives the turn away, for null move pruning. The board does
+    // not change, so nothing is pushed to the history.
+    void passTurn() {
+        assert(winner == None);
+        swapPlayer();
+    }
+
+    void undoPassTurn() {
+        zobrist ^= Zobrist::player(P1);
+        currentPlayer = (currentPlayer == P0 ? P1 : P0);
+        --nbTurns;
+    }
+
+    // Passing the turn is not a fair guess of the best action when the king is
+    // attacked, or when the side to move has nothing to drop and at most one piece
+    // besides its king : every action it has may then make things worse.
+    bool zugzwangRisk() const {
+        if(isKingAttacked()) return true;
+        const size_t inReserve = (currentPlayer == P0 ? reserve0.size() : reserve1.size());
+        const size_t onBoard = (currentPlayer == P0 ? analysis.nbOccupied0() : analysis.nbOccupied1());
+        return inReserve == 0 && onBoard <= 2;
+    }
+
 };
 
 
@@ -0,0 +1,101 @@
+#ifndef ORDERINGHEURISTICS_H
+#define ORDERINGHEURISTICS_H
+
+#include "action.h"
+#include "gamestate.h"
+#include "gameconfig.h"
+#include "minimax/score.h"
+#include <array>
+#include <cstdint>
+
+// What the search learned about quiet actions (moves and drops that capture nothing) :
+//  - killers  : the last two actions that caused a cutoff at each ply
+//  - history  : how often an action caused a cutoff anywhere, weighted by depth,
+//               indexed by (piece, src, dst) or (piece, drop, dst)
+//  - counters : the action that last refuted a given (piece, dst) of the opponent
+// Actions are kept through their 16 bit Action::pack() encoding, 0 meaning none.
+struct OrderingHeuristics {
+
+    static constexpr int maxPly = 64;
+    static constexpr unsigned int squares = GameConfig::squares;
+    static constexpr unsigned int nbPieces = 16;
+    static constexpr score_t maxHistory = 1024;
+
+    // bonuses added to the static score of quiet actions
+    static constexpr score_t killerBonus = 4000;
+    static constexpr score_t secondKillerBonus = 3000;
+    static constexpr score_t counterBonus = 2000;
+
+    std::array<std::array<uint16_t, 2>, maxPly> killers;
+    std::array<std::array<std::array<score_t, squares>, squares+1>, nbPieces> history; // src == squares for drops
+    std::array<std::array<uint16_t, squares>, nbPieces> counters;
+
+
+    OrderingHeuristics() :
+        killers(),
+        history(),
+        counters()
+    { }
+
+    // killers only make sense within a search, history is kept but aged
+    void newSearch() {
+        killers = {};
+        for(auto& bySrc : history) {
+            for(auto& byDst : bySrc) {
+                for(score_t& h : byDst) h /= 2;
+            }
+        }
+    }
+
+    void clear() {
+        killers = {};
+        history = {};
+        counters = {};
+    }
+
+    // action caused a cutoff in state, reached by previous at the given ply
+    void cutoff(const GameState& state, const Action& action, int ply, const Action* previous, int depth) {
+        if(!state.board.get(action.dst.idx()).empty()) return;
+        const uint16_t packed = action.pack();
+        if(ply < maxPly && killers[ply][0] != packed) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = packed;
+        }
+        score_t& h = historyOf(action);
+        h += depth*depth;
+        if(h > maxHistory) {
+            for(auto& bySrc : history) {
+                for(auto& byDst : bySrc) {
+                    for(score_t& v : byDst) v /= 2;
+                }
+            }
+        }
+        if(previous) counters[previous->p.id()][previous->dst.idx()] = packed;
+    }
+
+    // bonus of a quiet action at the given ply, after previous
+    score_t bonus(const Action& action, int ply, const Action* previous) const {
+        const uint16_t packed = action.pack();
+        score_t b = history[action.p.id()][srcOf(action)][action.dst.idx()];
+        if(ply < maxPly) {
+            if(killers[ply][0] == packed) b += killerBonus;
+            else if(killers[ply][1] == packed) b += secondKillerBonus;
+        }
+        if(previous && counters[previous->p.id()][previous->dst.idx()] == packed) b += counterBonus;
+        return b;
+    }
+
+private:
+
+    static unsigned int srcOf(const Action& action) {
+        return action.type == Drop ? squares : action.src.idx();
+    }
+
+    score_t& historyOf(const Action& action) {
+        return history[action.p.id()][srcOf(action)][action.dst.idx()];
+    }
+
+};
+
+
+#endif
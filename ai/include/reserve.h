@@ -2,70 +2,91 @@
 #define RESERVE_H
 
 #include "piece.h"
+#include "zobrist.h"
 #include <array>
+#include <bit>
+#include <type_traits>
 #include <cassert>
 #include <string>
 
-using reserve_hash_t = unsigned long long;
-
+// The reserve only stores how many pieces of each type it holds, packed on
+// a few bits per type, so equal material always gives equal reserves.
 template<Color c, unsigned int ressize>
 struct Reserve {
 
-    std::array<Piece, ressize> reserve;
-    uint8_t size;
+    static constexpr unsigned int bitsPerType = std::bit_width(ressize);
+
+    using counts_t = std::conditional_t<(NB_PIECE_TYPE*bitsPerType <= 32), uint32_t, uint64_t>;
+
+    static constexpr counts_t typeMask = (counts_t(1) << bitsPerType) - 1;
+
+    static_assert(ressize <= typeMask);
+    static_assert(NB_PIECE_TYPE*bitsPerType <= 8*sizeof(counts_t));
+
+    counts_t counts;
 
     Reserve() :
-        reserve(),
-        size(0)
+        counts(0)
     { }
 
     Reserve(const std::string& res) :
-        reserve(),
-        size(0)
+        counts(0)
     {
-        if(res.length() == 1 && res[0] == '.') return;
-        for(size_t i = 0; i < res.size(); ++i) {
-            push(Piece(res[i]));
-            if(size == ressize) assert(false);
+        for(char pc : res) {
+            if(pc == '.') continue;
+            push(Piece(pc));
         }
     }
 
+    static constexpr unsigned int shift(PieceType pt) { return bitsPerType*pt; }
+
     void push(const Piece p) {
-        assert(size < ressize);
-        reserve[size] = p;
-        reserve[size].setColor(c);
-        size++;
+        assert(size() < ressize);
+        assert(p.type() != NoType);
+        counts += counts_t(1) << shift(p.type());
+    }
+
+    Piece pop(PieceType pt) {
+        assert(count(pt) > 0);
+        counts -= counts_t(1) << shift(pt);
+        return Piece(pt, c);
     }
 
-    Piece pop(uint8_t pos) {
-        assert(pos < size);
-        size--;
-        std::swap(reserve[pos], reserve[size]);
-        return reserve[size];
+    uint8_t count(PieceType pt) const {
+        return (counts >> shift(pt)) & typeMask;
     }
 
+    bool has(PieceType pt) const {
+        return (counts >> shift(pt)) & typeMask;
+    }
+
+    uint8_t size() const {
+        uint8_t n = 0;
+        for(uint8_t pt = 0; pt < NB_PIECE_TYPE; ++pt) n += count((PieceType)pt);
+        return n;
+    }
+
+    bool empty() const { return counts == 0; }
+
     std::string toString() const {
         std::string s;
-        for(uint8_t i = 0; i < size; ++i) {
-            s += reserve[i].toChar();
+        for(uint8_t pt = 0; pt < NB_PIECE_TYPE; ++pt) {
+            const char pc = Piece((PieceType)pt, c).toChar();
+            for(uint8_t i = 0; i < count((PieceType)pt); ++i) s += pc;
         }
         return s;
     }
 
-    const Piece& operator[](uint8_t pos) const {
-        assert(pos < size);
-        return reserve[pos];
-    }
-
-    reserve_hash_t hash() const {
-        reserve_hash_t val = 0;
-        for(Piece p : *this) val = NB_PIECE_TYPE*(1+p.id());
+    hash_t hash() const {
+        hash_t val = 0;
+        for(uint8_t pt = 0; pt < NB_PIECE_TYPE; ++pt) val ^= Zobrist::reserve(c, (PieceType)pt, count((PieceType)pt));
         return val;
     }
 
-    const Piece* begin() const { return reserve.data(); }
-    const Piece* end() const { return reserve.data()+size; }
+    bool operator==(const Reserve& other) const {
+        return counts == other.counts;
+    }
 
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,8 @@
 #define SMALLBITSET_H
 
 #include <stdlib.h>
+#include <cstdint>
+#include <bit>
 
 template<unsigned int N, typename UInt>
 struct SmallBitset {
@@ -16,14 +18,20 @@ struct SmallBitset {
     
     constexpr SmallBitset operator&(SmallBitset a) const { SmallBitset b = *this; b &= a; return b; }
     constexpr SmallBitset operator|(SmallBitset a) const { SmallBitset b = *this; b |= a; return b; }
-    constexpr SmallBitset operator~() const { return SmallBitset{~val}; }
+    constexpr SmallBitset operator~() const { return SmallBitset{UInt(~val)}; }
+
+    constexpr bool operator==(SmallBitset a) const { return val == a.val; }
 
     constexpr void set(uint8_t pos) {
-        val |= (1 << pos);
+        val |= (UInt(1) << pos);
+    }
+
+    constexpr void reset(uint8_t pos) {
+        val &= ~(UInt(1) << pos);
     }
 
     constexpr size_t count() const {
-        return  __builtin_popcount(val);
+        return std::popcount(val);
     }
 
     constexpr bool any() const { return val; }
@@ -32,7 +40,22 @@ struct SmallBitset {
         return (val >> pos) & 1;
     }
 
+    // index of the lowest set bit, the bitset must not be empty
+    constexpr uint8_t first() const {
+        return std::countr_zero(val);
+    }
+
+    // removes the lowest set bit and returns its index
+    constexpr uint8_t popFirst() {
+        const uint8_t pos = first();
+        val &= val-1;
+        return pos;
+    }
+
+    // all bits of the N-sized set
+    static constexpr SmallBitset full() { return SmallBitset{(UInt(1) << N) - 1}; }
+
     UInt val;
 };
 
-#endif
\ No newline at end of file
+#endif
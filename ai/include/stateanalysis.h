@@ -1,7 +1,8 @@
 #ifndef BOARDANALYSIS_H
 #define BOARDANALYSIS_H
 
-#include "gamestate.h"
+#include "board.h"
+#include "reserve.h"
 #include "gamelogic.h"
 #include "gameconfig.h"
 #include "smallbitset.h"
@@ -9,48 +10,6 @@
 #include <cassert>
 #include <array>
 
-using mask_t = SmallBitset<GameConfig::rows*GameConfig::cols, unsigned int>;
-
-template<typename T, unsigned int N, unsigned int... Ns>
-struct multi_array {
-    std::array< multi_array<T, Ns...>, N> array;
-
-    constexpr multi_array<T, Ns...>& operator[](uint8_t pos) { return array[pos]; }
-    constexpr const multi_array<T, Ns...>& operator[](uint8_t pos) const { return array[pos]; }
-};
-
-template<typename T, unsigned int N>
-struct multi_array<T, N> {
-    std::array<T, N> array;
-
-    constexpr T& operator[](uint8_t pos) { return array[pos]; }
-    constexpr const T& operator[](uint8_t pos) const { return array[pos]; }
-};
-
-
-template<unsigned int rows = GameConfig::rows, unsigned int cols = GameConfig::cols>
-using mask_storage = multi_array<mask_t, 2, NB_PIECE_TYPE, rows*cols>;
-
-template<unsigned int rows = GameConfig::rows, unsigned int cols = GameConfig::cols>
-constexpr mask_storage<> computeAllMasks() {
-    using mask = mask_t;
-
-    mask_storage<> result;
-    for(uint8_t player = 0; player < 2; ++player) {
-        for(uint8_t id = 0; id < NB_PIECE_TYPE; ++id) {
-            for(uint8_t pos = 0; pos < rows*cols; ++pos) {
-                Piece piece((PieceType)id, (Color)player);
-                Pos current(pos);
-                unsigned long mask_proxy = 0;
-                for(Pos p : GameLogic::moveSet(piece, current)) mask_proxy |= (1 << p.idx());
-                mask m(mask_proxy);
-                result[player][id][pos] = m;
-            }
-        }
-    }
-    return result;
-}
-
 struct StateAnalysis {
 
     static constexpr unsigned int rows = GameConfig::rows;
@@ -59,7 +18,7 @@ struct StateAnalysis {
 
     using mask = mask_t;
 
-    static constexpr mask_storage<> allMasks = computeAllMasks();
+    static constexpr const mask_storage<>& allMasks = MoveMasks::allMasks;
 
     mask occupied0;
     mask occupied1;
@@ -79,6 +38,9 @@ struct StateAnalysis {
     std::array<short, NB_PIECE_TYPE> inReserve0;
     std::array<short, NB_PIECE_TYPE> inReserve1;
 
+    // number of pieces of each player controlling each square
+    std::array<std::array<uint8_t, rows*cols>, NB_PLAYERS> controlCount;
+
     StateAnalysis() = default;
 
     StateAnalysis(const Board& board, const Reserve<P0, ressize>& reserve0, const Reserve<P1, ressize>& reserve1) :
@@ -93,36 +55,72 @@ struct StateAnalysis {
         onBoard0(),
         onBoard1(),
         inReserve0(),
-        inReserve1()
+        inReserve1(),
+        controlCount()
     {
-        std::fill(onBoard0.begin(), onBoard0.end(), 0);
-        std::fill(onBoard1.begin(), onBoard1.end(), 0);
-        size_t pos = 0;
-        for(Piece piece : board) {
-            if(piece.color() == Color::P0) {
-                occupied0.set(pos);
-                ++onBoard0[(int)piece.type()];
-                controlled0 |= allMasks[Color::P0][piece.type()][pos];
-                if(piece.type() == PieceType::King) {
-                    kingPosition0.set(pos);
-                    kingControl0 = allMasks[Color::P0][PieceType::King][pos];
-                }
-            }
-            if(piece.color() == Color::P1) {
-                occupied1.set(pos);
-                ++onBoard1[(int)piece.type()];
-                controlled1 |= allMasks[Color::P1][piece.type()][pos];
-                if(piece.type() == PieceType::King) {
-                    kingPosition1.set(pos);
-                    kingControl1 = allMasks[Color::P1][PieceType::King][pos];
-                }
-            }
-            ++pos;
+        for(uint8_t i = 0; i < rows*cols; ++i) {
+            const Piece p = board.get(i);
+            if(!p.empty()) add(p, i);
+        }
+        for(uint8_t type = 0; type < NB_PIECE_TYPE; ++type) {
+            inReserve0[type] = reserve0.count((PieceType)type);
+            inReserve1[type] = reserve1.count((PieceType)type);
         }
-        std::fill(inReserve0.begin(), inReserve0.end(), 0);
-        for(Piece piece : reserve0) ++inReserve0[(int)piece.type()];
-        std::fill(inReserve1.begin(), inReserve1.end(), 0);
-        for(Piece piece : reserve1) ++inReserve1[(int)piece.type()];
+    }
+
+    // The game state keeps its analysis up to date through these updates
+    // instead of rebuilding it for every node.
+
+    void add(Piece p, uint8_t pos) {
+        const Color c = p.color();
+        const PieceType pt = p.type();
+        mask& occupied = (c == Color::P0 ? occupied0 : occupied1);
+        mask& controlled = (c == Color::P0 ? controlled0 : controlled1);
+        std::array<uint8_t, rows*cols>& count = controlCount[c];
+        occupied.set(pos);
+        ++(c == Color::P0 ? onBoard0 : onBoard1)[pt];
+        mask targets = allMasks[c][pt][pos];
+        while(targets.any()) {
+            const unsigned int i = targets.popFirst();
+            if(count[i]++ == 0) controlled.set(i);
+        }
+        if(pt == PieceType::King) {
+            (c == Color::P0 ? kingPosition0 : kingPosition1).set(pos);
+            (c == Color::P0 ? kingControl0 : kingControl1) = allMasks[c][pt][pos];
+        }
+    }
+
+    void remove(Piece p, uint8_t pos) {
+        const Color c = p.color();
+        const PieceType pt = p.type();
+        mask& occupied = (c == Color::P0 ? occupied0 : occupied1);
+        mask& controlled = (c == Color::P0 ? controlled0 : controlled1);
+        std::array<uint8_t, rows*cols>& count = controlCount[c];
+        occupied.reset(pos);
+        --(c == Color::P0 ? onBoard0 : onBoard1)[pt];
+        mask targets = allMasks[c][pt][pos];
+        while(targets.any()) {
+            const unsigned int i = targets.popFirst();
+            assert(count[i] > 0);
+            if(--count[i] == 0) controlled.reset(i);
+        }
+        if(pt == PieceType::King) {
+            (c == Color::P0 ? kingPosition0 : kingPosition1).reset(pos);
+            (c == Color::P0 ? kingControl0 : kingControl1) = mask();
+        }
+    }
+
+    void addReserve(Piece p) { ++(p.color() == Color::P0 ? inReserve0 : inReserve1)[p.type()]; }
+    void removeReserve(Piece p) { --(p.color() == Color::P0 ? inReserve0 : inReserve1)[p.type()]; }
+
+    bool operator==(const StateAnalysis& other) const {
+        return occupied0 == other.occupied0 && occupied1 == other.occupied1
+            && controlled0 == other.controlled0 && controlled1 == other.controlled1
+            && kingPosition0 == other.kingPosition0 && kingPosition1 == other.kingPosition1
+            && kingControl0 == other.kingControl0 && kingControl1 == other.kingControl1
+            && onBoard0 == other.onBoard0 && onBoard1 == other.onBoard1
+            && inReserve0 == other.inReserve0 && inReserve1 == other.inReserve1
+            && controlCount == other.controlCount;
     }
 
     size_t nbOccupied0() const { return occupied0.count(); }
@@ -136,6 +134,9 @@ struct StateAnalysis {
     size_t nbDanger0() const { return (occupied0&controlled1).count(); }
     size_t nbDanger1() const { return (occupied1&controlled0).count(); }
 
+    bool canCapture0() const { return (controlled0&occupied1).any(); }
+    bool canCapture1() const { return (controlled1&occupied0).any(); }
+
     bool isKingAttacked0() const { return (controlled1&kingPosition0).any(); }
     bool isKingAttacked1() const { return (controlled0&kingPosition1).any(); }
 
@@ -154,12 +155,12 @@ struct StateAnalysis {
 
     size_t kingDistance0() const {
         if(!hasKing0()) return 0;
-        return rows-1-__builtin_ctz(kingPosition0.val)/cols;
+        return rows-1-kingPosition0.first()/cols;
     }
 
     size_t kingDistance1() const {
         if(!hasKing1()) return 0;
-        return __builtin_ctz(kingPosition1.val)/cols;
+        return kingPosition1.first()/cols;
     }
 
 };
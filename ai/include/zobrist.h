@@ -0,0 +1,70 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "enums.h"
+#include "gameconfig.h"
+#include "constants.h"
+#include <array>
+#include <cstdint>
+
+using hash_t = uint64_t;
+
+struct ZobristKeys {
+    static constexpr unsigned int squares = GameConfig::rows*GameConfig::cols;
+    static constexpr unsigned int ressize = GameConfig::ressize;
+    static constexpr unsigned int nbPieces = NB_PLAYERS*NB_PIECE_TYPE;
+
+    std::array<std::array<hash_t, nbPieces>, squares> board;
+    std::array<std::array<std::array<hash_t, ressize+1>, NB_PIECE_TYPE>, NB_PLAYERS> reserve;
+    hash_t player;
+};
+
+constexpr hash_t splitmix64(hash_t& state) {
+    hash_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys computeZobristKeys() {
+    ZobristKeys k {};
+    hash_t state = 0x59b0ca1f3e2d4c87ull;
+    for(auto& sq : k.board) {
+        sq[0] = 0; // NoType, P0
+        sq[1] = 0; // NoType, P1
+        for(unsigned int p = 2; p < ZobristKeys::nbPieces; ++p) sq[p] = splitmix64(state);
+    }
+    for(auto& player : k.reserve) {
+        for(auto& type : player) {
+            type[0] = 0;
+            for(unsigned int n = 1; n <= ZobristKeys::ressize; ++n) type[n] = splitmix64(state);
+        }
+    }
+    k.player = splitmix64(state);
+    return k;
+}
+
+// Zobrist keys for the board squares, the reserve contents and the side to move.
+// A reserve is keyed by how many pieces of each type it holds, so its key
+// does not depend on the order in which pieces were captured.
+struct Zobrist {
+
+    static constexpr ZobristKeys keys = computeZobristKeys();
+
+    // key of piece id p on square pos, empty squares have a null key
+    static constexpr hash_t square(uint8_t pos, uint8_t p) {
+        return keys.board[pos][p];
+    }
+
+    // key of a reserve of player c holding count pieces of type pt
+    static constexpr hash_t reserve(Color c, PieceType pt, uint8_t count) {
+        return keys.reserve[c][pt][count];
+    }
+
+    static constexpr hash_t player(Color c) {
+        return c == P1 ? keys.player : 0;
+    }
+
+};
+
+#endif
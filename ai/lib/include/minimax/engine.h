@@ -0,0 +1,120 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "lazysmp.h"
+#include "searchlimits.h"
+#include "searchstats.h"
+#include <optional>
+#include <type_traits>
+
+// What a player keeps from one move to the next of a game : the transposition table,
+// the ordering heuristics, its agent and the game itself, with its history so that
+// repetitions across moves are seen. Both sides of the game are played on the engine,
+// and consecutive searches start from the tables the previous ones left.
+// Not copyable, the state points to the history of the engine.
+template<Mode mode, typename Action, typename ActionSet, typename GameState, typename Agent, typename ActionOrdering>
+struct Engine {
+
+    using Search = LazySMP<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    using TT = typename Search::TT;
+    using Heuristics = typename Search::Heuristics;
+    using History = std::remove_pointer_t<decltype(GameState::history)>;
+
+    TT tt;
+    Heuristics heuristics;
+    Agent agent;
+    History history;
+    GameState state;
+    unsigned int nbThreads;
+
+    // of the last search
+    std::optional<Action> bestAction;
+    std::optional<Action> reply; // the opponent move the last search expects
+    score_t score;
+    SearchStats stats;
+
+
+    explicit Engine(unsigned int nbThreads = 1) :
+        tt(),
+        heuristics(),
+        agent(),
+        history(),
+        state(&history),
+        nbThreads(nbThreads),
+        bestAction(),
+        reply(),
+        score(0),
+        stats()
+    { }
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    // forgets everything learned, and starts from the position built from args,
+    // the initial position when there are none
+    template<typename... Args>
+    void newGame(Args&&... args) {
+        tt.clear();
+        heuristics.clear();
+        newHistory(std::forward<Args>(args)...);
+    }
+
+    // makes position, built from args, the current one : it is played when it follows
+    // the current position by one action, and otherwise starts a new history there
+    // while the tables are kept
+    template<typename... Args>
+    void follow(Args&&... args) {
+        const GameState position(nullptr, args...);
+        if(samePosition(state, position)) return;
+        if(!state.gameOver()) {
+            ActionSet actions;
+            state.fillAllowedActions(&actions);
+            for(const Action& action : actions.actions) {
+                typename GameState::Undo undo;
+                state.apply(action, undo);
+                if(samePosition(state, position)) return;
+                state.undo(undo);
+            }
+        }
+        newHistory(std::forward<Args>(args)...);
+    }
+
+    // no action when the game is over, the history may end it by repetition or turns
+    std::optional<Action> search(const SearchLimits& limits) {
+        if(state.gameOver()) {
+            bestAction.reset();
+            reply.reset();
+            score = 0;
+            stats = SearchStats();
+            return bestAction;
+        }
+        Search search(state, agent, &tt, nbThreads);
+        search.heuristics = &heuristics;
+        score = search.run(limits);
+        bestAction = search.bestAction;
+        reply = search.reply;
+        stats = search.stats;
+        return bestAction;
+    }
+
+    // action of either side
+    bool play(const Action& action) {
+        return state.apply(action);
+    }
+
+private:
+
+    template<typename... Args>
+    void newHistory(Args&&... args) {
+        history = History();
+        state = GameState(&history, std::forward<Args>(args)...);
+    }
+
+    static bool samePosition(const GameState& a, const GameState& b) {
+        return a.hash() == b.hash() && a.currentPlayer == b.currentPlayer;
+    }
+
+};
+
+
+#endif
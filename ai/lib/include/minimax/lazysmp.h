@@ -0,0 +1,115 @@
+#ifndef LAZYSMP_H
+#define LAZYSMP_H
+
+#include "minimax.h"
+#include "searchlimits.h"
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Lazy SMP : helper threads run the same iterative search on their own copy of
+// the position and history, and only cooperate through the shared transposition
+// table. Helpers start one or two depths ahead so that they fill the table with
+// results the main thread asks for next. The main thread alone decides the action,
+// and raises the stop flag of the helpers when it is done.
+// Without thread support (emscripten builds), only the main thread searches.
+// YoungBrothers searches split the tree themselves, on a pool of nbThreads threads.
+template<Mode mode, typename Action, typename ActionSet, typename GameState, typename Agent, typename ActionOrdering>
+struct LazySMP {
+
+    using Search = Minimax<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    using TT = typename Search::TT;
+    using Heuristics = typename Search::Heuristics;
+    using History = std::remove_pointer_t<decltype(GameState::history)>;
+
+    static constexpr unsigned int maxThreads = 64;
+
+    GameState& root;
+    std::optional<Action> bestAction;
+    Agent& agent;
+    TT* tt;
+    std::unique_ptr<TT> ownTable; // threads only share their work through a table
+    unsigned int nbThreads;
+    SearchStats stats; // of the main thread, with the counters of the helpers added
+    std::optional<Action> reply; // expected by the main thread to its best action
+    Heuristics* heuristics; // when set, the main thread starts from and updates these
+
+
+    LazySMP(GameState& root, Agent& agent, TT* tt = nullptr, unsigned int nbThreads = 1) :
+        root(root),
+        bestAction(),
+        agent(agent),
+        tt(tt),
+        ownTable(),
+        nbThreads(std::max(1u, std::min(maxThreads, nbThreads))),
+        stats(),
+        reply(),
+        heuristics(nullptr)
+    {
+        if(!tt && this->nbThreads > 1 && mode != YoungBrothers) {
+            ownTable = std::make_unique<TT>();
+            this->tt = ownTable.get();
+        }
+    }
+
+
+    score_t run(int maxDepth) {
+        return run(SearchLimits::fixedDepth(maxDepth));
+    }
+
+    score_t run(const SearchLimits& limits) {
+#ifdef __EMSCRIPTEN__
+        const unsigned int nbHelpers = 0;
+#else
+        const unsigned int nbHelpers = (mode == YoungBrothers ? 0 : nbThreads - 1);
+#endif
+        // copies are made before the main search starts to modify the root
+        std::vector<History> histories;
+        std::vector<GameState> states;
+        std::vector<Agent> agents;
+        histories.reserve(nbHelpers);
+        states.reserve(nbHelpers);
+        agents.reserve(nbHelpers);
+        for(unsigned int i = 0; i < nbHelpers; ++i) {
+            if(root.history) histories.push_back(*root.history);
+            states.push_back(root);
+            if(root.history) states.back().history = &histories.back();
+            agents.push_back(agent);
+        }
+
+        StopSignal stop;
+        std::vector<SearchStats> helperStats(nbHelpers);
+        std::vector<std::thread> helpers;
+        helpers.reserve(nbHelpers);
+        for(unsigned int i = 0; i < nbHelpers; ++i) {
+            helpers.emplace_back([&, i]() {
+                Search helper(states[i], agents[i], tt);
+                helper.stopFlag = &stop;
+                helper.firstDepth = 1 + i % 2;
+                helper.run(limits);
+                helperStats[i] = helper.stats;
+            });
+        }
+
+        Search main(root, agent, tt);
+        main.nbThreads = nbThreads;
+        if(heuristics) main.heuristics = *heuristics;
+        const score_t res = main.run(limits);
+        stop.raise();
+        for(std::thread& helper : helpers) helper.join();
+
+        if(heuristics) *heuristics = main.heuristics;
+        bestAction = main.bestAction;
+        reply = main.expectedReply();
+        stats = main.stats;
+        for(const SearchStats& helperStat : helperStats) stats.add(helperStat);
+        return res;
+    }
+
+};
+
+
+#endif
@@ -2,265 +2,1005 @@
 #define MINIMAX_H
 
 #include "logger.h"
-#include <limits>
+#include "score.h"
+#include "searchlimits.h"
+#include "searchstats.h"
+#include "transpositiontable.h"
+#include "workstealingpool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 
 enum Mode {
     PureMinimax,
     AlphaBeta,
-    IterativeDeepening
+    IterativeDeepening,
+    PrincipalVariation,
+    MTDf,
+    YoungBrothers
 };
 
 template<Mode mode, typename Action, typename ActionSet, typename GameState, typename Agent, typename ActionOrdering>
 struct Minimax {
 
+    // alpha-beta searches avoid repetitions almost as if they were lost, an actual loss
+    // still being worse
+    static constexpr score_t drawScore = Score::lossBound + 1;
+
+    // initial half width of the aspiration windows, in evaluation units
+    static constexpr score_t aspirationWindow = 200;
+
+    // quiescence : captures are skipped when even winning the piece and this margin
+    // cannot raise alpha, and king threats are answered for at most maxQuiescencePly plies
+    static constexpr bool deltaPruning = true;
+    static constexpr score_t deltaMargin = 200;
+    static constexpr int maxQuiescencePly = 8;
+
+    // Null move pruning : the side to move passes, and when a search reduced by
+    // nullMoveReduction still fails high, so does the node
+    static constexpr bool nullMovePruning = true;
+    static constexpr int nullMoveMinDepth = 3;
+    static constexpr int nullMoveReduction = 2;
+
+    // Late move reductions : quiet actions ordered after the first lmrFullMoves ones are
+    // searched one ply shallower, two after lmrLateMoves, and again to full depth when
+    // they fail high
+    static constexpr bool lateMoveReductions = true;
+    static constexpr int lmrMinDepth = 3;
+    static constexpr int lmrFullMoves = 3;
+    static constexpr int lmrLateMoves = 8;
+
+    // YoungBrothers only splits nodes with at least this depth left
+    static constexpr int splitDepth = 3;
+
+    using TT = TranspositionTable<Action>;
+
     GameState& root;
     std::optional<Action> bestAction;
     Agent& agent;
+    TT* tt;
+    std::unique_ptr<TT> ownTable; // MTDf relies on a table, used when none is given
 
+    using Heuristics = typename ActionOrdering::Heuristics;
+    Heuristics heuristics;
+    std::array<Action, Heuristics::maxPly> line; // actions leading to the current node, empty for a pass
+    bool afterNullMove; // the current node was reached by a pass
 
-    Minimax(GameState& root, Agent& agent) :
+    // draws depend on the path to a position and not only on the position itself,
+    // so scores of subtrees that met a draw are never stored in the table
+    unsigned long long nbDraws;
+    unsigned int rootRepetitions; // repeated boards of the game before the root
+
+    // time and node limits, which only stop iterative searches once a first depth completed
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start;
+    unsigned long long nbNodes;
+    bool abortable;
+    bool aborted;
+
+    // set by parallel searches : helpers stop when the flag is raised, and start
+    // their iterative deepening at firstDepth so that threads spread over depths
+    const StopSignal* stopFlag;
+    int firstDepth;
+
+    // filled by run, see searchstats.h
+    SearchStats stats;
+
+    // YoungBrothers : threads of the pool created by run, and that pool
+    unsigned int nbThreads;
+    WorkStealingPool* pool;
+
+
+    Minimax(GameState& root, Agent& agent, TT* tt = nullptr) :
         root(root),
         bestAction(),
-        agent(agent)
-    { }
+        agent(agent),
+        tt(tt),
+        ownTable(),
+        heuristics(),
+        line(),
+        afterNullMove(false),
+        nbDraws(0),
+        rootRepetitions(0),
+        limits(SearchLimits::fixedDepth(0)),
+        start(),
+        nbNodes(0),
+        abortable(false),
+        aborted(false),
+        stopFlag(nullptr),
+        firstDepth(0),
+        stats(),
+        nbThreads(1),
+        pool(nullptr)
+    {
+        // results of YoungBrothers must not depend on what other threads stored
+        if(mode == YoungBrothers) this->tt = nullptr;
+        if(mode == MTDf && !tt) {
+            ownTable = std::make_unique<TT>();
+            this->tt = ownTable.get();
+        }
+    }
+
 
+    score_t run(int maxDepth) {
+        return run(SearchLimits::fixedDepth(maxDepth));
+    }
 
-    double run(int maxDepth) {
-        const double inf = std::numeric_limits<double>::infinity();
-        double res = 0.0;
+    score_t run(const SearchLimits& searchLimits) {
+        const score_t inf = Score::infinity;
+        const int maxDepth = searchLimits.depth;
+        score_t res = 0;
+        limits = searchLimits;
+        start = std::chrono::steady_clock::now();
+        nbNodes = 0;
+        stats = SearchStats();
+        abortable = (stopFlag != nullptr);
+        aborted = false;
+        afterNullMove = false;
+        rootRepetitions = root.nbRepetitions();
+        bestAction.reset();
+        if(tt && !stopFlag) tt->newSearch(); // helpers share the search of their main thread
+        heuristics.newSearch();
         if(mode == PureMinimax) {
             res = search(root, maxDepth, maxDepth);
+            stats.iterations.push_back({maxDepth, nbNodes, elapsedMilliseconds(), res, !aborted});
         }
         if(mode == AlphaBeta) {
             res = alphaBetaSearch(root, maxDepth, maxDepth, -inf, inf);
+            stats.iterations.push_back({maxDepth, nbNodes, elapsedMilliseconds(), res, !aborted});
         }
-        if(mode == IterativeDeepening) {
+        if(mode == IterativeDeepening || mode == PrincipalVariation || mode == MTDf) {
             res = iterativeDeepening(root, maxDepth);
         }
-        if(res == -inf) {
+        if(mode == YoungBrothers) {
+            WorkStealingPool threads(nbThreads - 1);
+            pool = &threads;
+            res = iterativeDeepening(root, maxDepth);
+            pool = nullptr;
+        }
+        if(!bestAction) {
             ActionSet actionset;
             root.fillAllowedActions(&actionset);
-            bestAction = actionset[0];
+            if(!actionset.empty()) bestAction = actionset[0]; // none when the game is over
         }
+        stats.nodes = nbNodes;
+        stats.milliseconds = elapsedMilliseconds();
         return res;
     }
 
+    // Reply the last search expects to its best action : the action the table keeps
+    // for the position that action leads to, next in the principal variation
+    std::optional<Action> expectedReply() {
+        if(!tt || !bestAction) return std::nullopt;
+        std::optional<Action> reply;
+        typename GameState::Undo undo;
+        [[maybe_unused]] bool validMove = root.apply(*bestAction, undo);
+        assert(validMove);
+        if(!root.gameOver()) {
+            const std::optional<typename TT::Probe> entry = tt->probe(root.hash());
+            if(entry && entry->action && root.checkAction(*entry->action)) reply = entry->action;
+        }
+        root.undo(undo);
+        return reply;
+    }
+
 private:
 
-    double search(GameState currentState, int maxDepth, int depth) {
+    static constexpr unsigned long long checkInterval = 1024;
+
+    // counts the node, and tells whether the search has to stop
+    bool stopped() {
+        ++nbNodes;
+        if(aborted || !abortable || nbNodes % checkInterval != 0) return aborted;
+        if(stopFlag && stopFlag->raised()) aborted = true;
+        if(limits.nodes > 0 && nbNodes >= limits.nodes) aborted = true;
+        if(limits.milliseconds > 0) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            if(elapsed >= std::chrono::milliseconds(limits.milliseconds)) aborted = true;
+        }
+        return aborted;
+    }
+
+    double elapsedMilliseconds() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // a node failed high after searching that many actions
+    void countCutoff(int actionsSearched) {
+        ++stats.cutoffs;
+        if(actionsSearched == 1) ++stats.firstMoveCutoffs;
+    }
+
+    void pushLine(int ply, const Action& action) {
+        if(ply < Heuristics::maxPly) line[ply] = action;
+    }
+
+    const Action* previousAction(int ply) const {
+        if(ply <= 0 || ply > Heuristics::maxPly || line[ply-1].p.empty()) return nullptr;
+        return &line[ply-1];
+    }
+
+    // Mate distance pruning : from a node at this ply, no score is better than a win at
+    // the next ply nor worse than a loss at the ply after. Returns whether the window
+    // is then empty. The root keeps its window, so that an immediate win still sets
+    // the best action.
+    static bool mateDistancePruning(int ply, score_t& alpha, score_t& beta) {
+        if(ply == 0) return false;
+        alpha = std::max(alpha, Score::lossIn(ply+2));
+        beta = std::min(beta, Score::winIn(ply+1));
+        return alpha >= beta;
+    }
+
+    // Returns the score of the passing side when the pass fails high, which is below a
+    // win since passing proves nothing about the king. Reduced searches lower maxDepth
+    // along with depth, so that maxDepth - depth stays the ply of the node.
+    // childSearch(maxDepth, depth) returns the score of the passing side, and is not run
+    // twice in a row nor at the root or in a principal variation.
+    template<typename ChildSearch>
+    std::optional<score_t> nullMoveCutoff(GameState& currentState, int maxDepth, int depth, score_t beta, bool pvNode, ChildSearch&& childSearch) {
+        const bool passed = afterNullMove;
+        afterNullMove = false;
+        if(!nullMovePruning || passed || pvNode || depth == maxDepth || depth < nullMoveMinDepth) return std::nullopt;
+        if(Score::isDecided(beta) || currentState.zugzwangRisk()) return std::nullopt;
+        const int ply = maxDepth - depth;
+        currentState.passTurn();
+        pushLine(ply, Action{});
+        afterNullMove = true;
+        const score_t evaluation = childSearch(maxDepth - nullMoveReduction, depth - 1 - nullMoveReduction);
+        afterNullMove = false;
+        currentState.undoPassTurn();
+        if(aborted || evaluation < beta) return std::nullopt;
+        return std::min(evaluation, Score::winBound - 1);
+    }
 
+    // Reduction of the moveIndex-th action of a node, already applied to currentState.
+    // Captures, actions that attack the king and answers to an attacked king are
+    // searched to full depth.
+    int lateMoveReduction(const GameState& currentState, int maxDepth, int depth, int moveIndex, bool quiet, bool inCheck) const {
+        if(!lateMoveReductions || !quiet || inCheck || depth == maxDepth) return 0;
+        if(depth < lmrMinDepth || moveIndex < lmrFullMoves || currentState.isKingAttacked()) return 0;
+        return std::min(moveIndex < lmrLateMoves ? 1 : 2, depth-2);
+    }
+
+    score_t search(GameState& currentState, int maxDepth, int depth) {
+
+        const int ply = maxDepth - depth;
         if(currentState.hasWon(currentState.currentPlayer)) {
-            return std::numeric_limits<double>::infinity();
+            return Score::winIn(ply);
         }
         if(currentState.hasLost(currentState.currentPlayer)) {
-            return -std::numeric_limits<double>::infinity();
+            return Score::lossIn(ply);
         }
         if(currentState.hasDraw()) {
             return agent.drawPenalty;
         }
-        
+
+        ++nbNodes;
         if(depth == 0) {
+            ++stats.evaluations;
             typename Agent::score score = agent.evaluate(currentState);
-            double eval = score.value(currentState.currentPlayer);
-            assert(eval == eval);
-            return eval;
+            return score.value(currentState.currentPlayer);
         }
 
-        ActionSet actionset;
-        currentState.fillAllowedActions(&actionset);
-        assert(!actionset.empty());
-
-        {
-            ActionOrdering orderer(&actionset, currentState);
-            orderer.sort();
-        }
+        ActionOrdering orderer(currentState);
+        Action action;
 
-        double bestEvaluation = -std::numeric_limits<double>::infinity();
-        for(Action action : actionset) {
-            GameState tmp = currentState;
-            bool validMove = tmp.apply(action);
+        score_t bestEvaluation = -Score::infinity;
+        while(orderer.next(action)) {
+            typename GameState::Undo undo;
+            bool validMove = currentState.apply(action, undo);
             assert(validMove);
-            double evaluation = -search(tmp, maxDepth, depth-1);
+            score_t evaluation = -search(currentState, maxDepth, depth-1);
             if(depth == maxDepth) {
                 Logger::log(Verb::Dev, [&](){ return action.toString() + " : " + std::to_string(evaluation); });
             }
-            assert(evaluation == evaluation);
             if(evaluation > bestEvaluation) {
                 bestEvaluation = evaluation;
                 if(depth == maxDepth) bestAction = action;
             }
-            if(validMove) tmp.revert();
+            if(validMove) currentState.undo(undo);
         }
             
-        assert(bestEvaluation == bestEvaluation);
         return bestEvaluation;
     }
 
 
-    double alphaBetaSearch(GameState currentState, int maxDepth, int depth, double alpha, double beta) {
+    score_t alphaBetaSearch(GameState& currentState, int maxDepth, int depth, score_t alpha, score_t beta) {
 
+        const int ply = maxDepth - depth;
         if(currentState.hasWon(currentState.currentPlayer)) {
-            return std::numeric_limits<double>::infinity();
+            return Score::winIn(ply);
         }
         if(currentState.hasLost(currentState.currentPlayer)) {
-            return -std::numeric_limits<double>::infinity();
+            return Score::lossIn(ply);
         }
         if(currentState.hasDraw()) {
-            return -std::numeric_limits<double>::infinity();
+            ++nbDraws;
+            return drawScore;
         }
         
+        // quiescence counts the node
         if(depth == 0) {
-            typename Agent::score score = agent.evaluate(currentState);
-            double eval = score.value(currentState.currentPlayer);
-            assert(eval == eval);
-            return eval;
+            return quiescence(currentState, alpha, beta, ply, maxQuiescencePly);
         }
 
-        ActionSet actionset;
-        currentState.fillAllowedActions(&actionset);
-        if(actionset.empty()) {
-            return -std::numeric_limits<double>::infinity();
-        }
-        assert(!actionset.empty());
+        if(stopped()) return 0;
 
-        {
-            ActionOrdering orderer(&actionset, currentState);
-            orderer.sort();
+        if(mateDistancePruning(ply, alpha, beta)) return alpha;
+
+        const score_t alphaOrig = alpha;
+        const unsigned long long drawsBefore = nbDraws;
+        std::optional<Action> ttAction;
+        if(std::optional<score_t> ttScore = probeTable(currentState, maxDepth, depth, alpha, beta, ttAction)) {
+            return *ttScore;
         }
 
-        double bestEvaluation = -std::numeric_limits<double>::infinity();
-        for(Action action : actionset) {
-            GameState tmp = currentState;
+        auto passSearch = [&](int reducedMaxDepth, int reducedDepth) {
+            return -alphaBetaSearch(currentState, reducedMaxDepth, reducedDepth, -beta, 1-beta);
+        };
+        if(nullMoveCutoff(currentState, maxDepth, depth, beta, false, passSearch)) return beta;
+        if(aborted) return 0;
+
+        const Action* previous = previousAction(ply);
+        const bool inCheck = currentState.isKingAttacked();
+        ActionOrdering orderer(currentState, ttAction ? &*ttAction : nullptr, &heuristics, ply, previous);
+        Action action;
+        std::optional<Action> nodeBest;
+        bool hasAction = false;
+        int moveIndex = 0;
+
+        while(orderer.next(action)) {
+            hasAction = true;
 #ifndef NDEBUG
-            const size_t historySize1 = tmp.history->positions.size();
+            const size_t historySize1 = currentState.history->positions.size();
 #endif
-            bool validMove = tmp.apply(action);
+            const bool quiet = currentState.board.get(action.dst.idx()).empty();
+            typename GameState::Undo undo;
+            [[maybe_unused]] bool validMove = currentState.apply(action, undo);
             assert(validMove);
-            double evaluation = -alphaBetaSearch(tmp, maxDepth, depth-1, -beta, -alpha);
+            pushLine(ply, action);
+            score_t evaluation = 0;
+            const int reduction = lateMoveReduction(currentState, maxDepth, depth, moveIndex++, quiet, inCheck);
+            if(reduction > 0) {
+                evaluation = -alphaBetaSearch(currentState, maxDepth-reduction, depth-1-reduction, -alpha-1, -alpha);
+            }
+            if(reduction == 0 || (evaluation > alpha && !aborted)) {
+                evaluation = -alphaBetaSearch(currentState, maxDepth, depth-1, -beta, -alpha);
+            }
+            if(aborted) {
+                currentState.undo(undo);
+                return 0;
+            }
             if(depth == maxDepth) {
                 Logger::log(Verb::Dev, [&](){ return action.toString() + " : " + std::to_string(evaluation); });
             }
-            assert(evaluation == evaluation);
             if(evaluation > beta) {
 #ifndef NDEBUG
                 assert(validMove);
                 if(validMove)
 #endif
-                tmp.revert();
+                currentState.undo(undo);
+                heuristics.cutoff(currentState, action, ply, previous, depth);
+                countCutoff(moveIndex);
+                storeTable(currentState, drawsBefore, ply, depth, beta, action, Bound::Lower);
                 return beta;
             }
             if(evaluation > alpha) {
                 alpha = evaluation;
+                nodeBest = action;
                 if(depth == maxDepth) bestAction = action;
             }
 #ifndef NDEBUG
             assert(validMove);
             if(validMove) 
 #endif
-            tmp.revert();
+            currentState.undo(undo);
 #ifndef NDEBUG
-            const size_t historySize2 = tmp.history->positions.size();
+            const size_t historySize2 = currentState.history->positions.size();
             assert(historySize1 == historySize2);
 #endif
         }
-            
-        assert(alpha == alpha);
+
+        if(!hasAction) {
+            return Score::lossIn(ply);
+        }
+
+        storeTable(currentState, drawsBefore, ply, depth, alpha, nodeBest, nodeBound(alphaOrig, alpha, beta));
         return alpha;
     }
 
 
-    double alphaBetaSearchWithHint(GameState currentState, int maxDepth, int depth, double alpha, double beta, Action* hint) {
+    score_t alphaBetaSearchWithHint(GameState& currentState, int maxDepth, int depth, score_t alpha, score_t beta, Action* hint) {
 
+        const int ply = maxDepth - depth;
         if(currentState.hasWon(currentState.currentPlayer)) {
-            return std::numeric_limits<double>::infinity();
+            return Score::winIn(ply);
         }
         if(currentState.hasLost(currentState.currentPlayer)) {
-            return -std::numeric_limits<double>::infinity();
+            return Score::lossIn(ply);
         }
         if(currentState.hasDraw()) {
-            return -std::numeric_limits<double>::infinity();
+            ++nbDraws;
+            return drawScore;
         }
         
         if(depth == 0) {
-            typename Agent::score score = agent.evaluate(currentState);
-            double eval = score.value(currentState.currentPlayer);
-            assert(eval == eval);
-            return eval;
+            return quiescence(currentState, alpha, beta, ply, maxQuiescencePly);
         }
 
-        ActionSet actionset;
-        currentState.fillAllowedActions(&actionset);
-        if(actionset.empty()) {
-            return -std::numeric_limits<double>::infinity();
-        }
+        if(stopped()) return 0;
 
-        {
-            ActionOrdering orderer(&actionset, currentState);
-            orderer.sort();
+        if(mateDistancePruning(ply, alpha, beta)) return alpha;
+
+        const score_t alphaOrig = alpha;
+        const unsigned long long drawsBefore = nbDraws;
+        std::optional<Action> ttAction;
+        if(std::optional<score_t> ttScore = probeTable(currentState, maxDepth, depth, alpha, beta, ttAction)) {
+            return *ttScore;
         }
+        if(!hint && ttAction) hint = &*ttAction;
+        std::optional<Action> nodeBest;
+        const Action* previous = previousAction(ply);
 
-        auto tryAction = [&](Action action) {
-            GameState tmp = currentState;
-            const size_t historySize1 = tmp.history->positions.size();
-            bool validMove = tmp.apply(action);
+        int actionsSearched = 0;
+
+        // returns the cutoff value when the action fails high
+        auto tryAction = [&](Action action) -> std::optional<score_t> {
+            ++actionsSearched;
+#ifndef NDEBUG
+            const size_t historySize1 = currentState.history->positions.size();
+#endif
+            typename GameState::Undo undo;
+            bool validMove = currentState.apply(action, undo);
             assert(validMove);
-            double evaluation = -alphaBetaSearch(tmp, maxDepth, depth-1, -beta, -alpha);
+            pushLine(ply, action);
+            score_t evaluation = -alphaBetaSearch(currentState, maxDepth, depth-1, -beta, -alpha);
+            if(aborted) {
+                if(validMove) currentState.undo(undo);
+                return 0;
+            }
             if(depth == maxDepth) {
                 Logger::log(Verb::Dev, [&](){ return action.toString() + " : " + std::to_string(evaluation); });
             }
-            assert(evaluation == evaluation);
             if(evaluation > beta) {
-                if(validMove) tmp.revert();
+                if(validMove) currentState.undo(undo);
+                heuristics.cutoff(currentState, action, ply, previous, depth);
+                countCutoff(actionsSearched);
+                storeTable(currentState, drawsBefore, ply, depth, beta, action, Bound::Lower);
                 return beta;
             }
             if(evaluation > alpha) {
                 alpha = evaluation;
+                nodeBest = action;
                 if(depth == maxDepth) bestAction = action;
             }
-            if(validMove) tmp.revert();
-            const size_t historySize2 = tmp.history->positions.size();
+            if(validMove) currentState.undo(undo);
+#ifndef NDEBUG
+            const size_t historySize2 = currentState.history->positions.size();
             assert(historySize1 == historySize2);
-            return std::numeric_limits<double>::quiet_NaN(); // return nan as "no return" flag
+#endif
+            return std::nullopt;
         };
 
-        double bestEvaluation = -std::numeric_limits<double>::infinity();
+        ActionOrdering orderer(currentState, hint, &heuristics, ply, previous);
+        Action action;
+        bool hasAction = false;
+
+        while(orderer.next(action)) {
+            hasAction = true;
+            std::optional<score_t> val = tryAction(action);
+            if(hint && action == *hint) {
+                Logger::log(Verb::Dev, [&](){
+                    return R"(hint returns : )" 
+                        + (val ? std::to_string(*val) : "none") + R"( )"
+                        + std::to_string(alpha) + R"( )"
+                        + std::to_string(beta);
+                    });
+            }
+            if(val) return *val;
+        }
 
-        if(hint) {
-            double val = tryAction(*hint);
-            Logger::log(Verb::Dev, [&](){
-                return R"(hint returns : )" 
-                    + std::to_string(val) + R"( )"
-                    + std::to_string(alpha) + R"( )"
-                    + std::to_string(beta);
-                });
-            if(val == val) return val;
+        if(!hasAction) {
+            return Score::lossIn(ply);
+        }
+
+        storeTable(currentState, drawsBefore, ply, depth, alpha, nodeBest, nodeBound(alphaOrig, alpha, beta));
+        return alpha;
+    }
+
+    // Fills ttAction with the stored action, and returns the score of the node when
+    // the stored bound is deep enough to decide it. The root is always searched, and
+    // so are positions where a repetition could make the stored score wrong.
+    std::optional<score_t> probeTable(const GameState& currentState, int maxDepth, int depth, score_t alpha, score_t beta, std::optional<Action>& ttAction) {
+        if(!tt) return std::nullopt;
+        ++stats.ttProbes;
+        const std::optional<typename TT::Probe> entry = tt->probe(currentState.hash());
+        if(!entry) return std::nullopt;
+        ++stats.ttHits;
+        ttAction = entry->action;
+        if(depth == maxDepth || entry->depth < depth || repetitionRisk(currentState)) return std::nullopt;
+        const score_t score = Score::fromTable(entry->score, maxDepth - depth);
+        if(entry->bound == Bound::Exact) return std::clamp(score, alpha, beta);
+        if(entry->bound == Bound::Lower && score >= beta) return beta;
+        if(entry->bound == Bound::Upper && score <= alpha) return alpha;
+        return std::nullopt;
+    }
+
+    // stored scores never include a draw by repetition, which may be missed when this
+    // board occurred before, or when a board was repeated since the root
+    bool repetitionRisk(const GameState& currentState) const {
+        return currentState.isRepeated() || currentState.nbRepetitions() > rootRepetitions;
+    }
+
+    // these searches only cut above beta : a child returning beta itself raises alpha to
+    // beta, and the node is then only known to be at least beta
+    static Bound nodeBound(score_t alphaOrig, score_t alpha, score_t beta) {
+        if(alpha >= beta) return Bound::Lower;
+        return alpha > alphaOrig ? Bound::Exact : Bound::Upper;
+    }
+
+    void storeTable(const GameState& currentState, unsigned long long drawsBefore, int ply, int depth, score_t score, const std::optional<Action>& action, Bound bound) {
+        if(tt && nbDraws == drawsBefore) tt->store(currentState.hash(), Score::toTable(score, ply), action, depth, bound);
+    }
+
+    // NegaScout : the first action is searched with the full window, the others with
+    // a null window that only proves they are not better, and are searched again
+    // with the full window when that proof fails.
+    score_t principalVariationSearch(GameState& currentState, int maxDepth, int depth, score_t alpha, score_t beta, const Action* hint) {
+
+        const int ply = maxDepth - depth;
+        if(currentState.hasWon(currentState.currentPlayer)) {
+            return Score::winIn(ply);
         }
-        for(Action action : actionset) {
-            double val = tryAction(action);
-            if(val == val) return val;
+        if(currentState.hasLost(currentState.currentPlayer)) {
+            return Score::lossIn(ply);
         }
-            
-        assert(alpha == alpha);
+        if(currentState.hasDraw()) {
+            ++nbDraws;
+            return drawScore;
+        }
+
+        if(depth == 0) {
+            return quiescence(currentState, alpha, beta, ply, maxQuiescencePly);
+        }
+
+        if(stopped()) return 0;
+
+        if(mateDistancePruning(ply, alpha, beta)) return alpha;
+
+        const score_t alphaOrig = alpha;
+        const unsigned long long drawsBefore = nbDraws;
+        std::optional<Action> ttAction;
+        if(std::optional<score_t> ttScore = probeTable(currentState, maxDepth, depth, alpha, beta, ttAction)) {
+            return *ttScore;
+        }
+        if(!hint && ttAction) hint = &*ttAction;
+
+        auto passSearch = [&](int reducedMaxDepth, int reducedDepth) {
+            return -principalVariationSearch(currentState, reducedMaxDepth, reducedDepth, -beta, 1-beta, nullptr);
+        };
+        if(nullMoveCutoff(currentState, maxDepth, depth, beta, beta - alpha > 1, passSearch)) return beta;
+        if(aborted) return 0;
+
+        const Action* previous = previousAction(ply);
+        const bool inCheck = currentState.isKingAttacked();
+        ActionOrdering orderer(currentState, hint, &heuristics, ply, previous);
+        Action action;
+        std::optional<Action> nodeBest;
+        bool first = true;
+        int moveIndex = 0;
+
+        while(orderer.next(action)) {
+            const bool quiet = currentState.board.get(action.dst.idx()).empty();
+            typename GameState::Undo undo;
+            [[maybe_unused]] bool validMove = currentState.apply(action, undo);
+            assert(validMove);
+            pushLine(ply, action);
+            score_t evaluation = 0;
+            if(first) {
+                evaluation = -principalVariationSearch(currentState, maxDepth, depth-1, -beta, -alpha, nullptr);
+            } else {
+                const int reduction = lateMoveReduction(currentState, maxDepth, depth, moveIndex, quiet, inCheck);
+                evaluation = -principalVariationSearch(currentState, maxDepth-reduction, depth-1-reduction, -alpha-1, -alpha, nullptr);
+                if(reduction > 0 && evaluation > alpha && !aborted) {
+                    evaluation = -principalVariationSearch(currentState, maxDepth, depth-1, -alpha-1, -alpha, nullptr);
+                }
+                if(evaluation > alpha && evaluation < beta && !aborted) {
+                    evaluation = -principalVariationSearch(currentState, maxDepth, depth-1, -beta, -alpha, nullptr);
+                }
+            }
+            currentState.undo(undo);
+            if(aborted) return 0;
+            first = false;
+            ++moveIndex;
+            if(depth == maxDepth) {
+                Logger::log(Verb::Dev, [&](){ return action.toString() + " : " + std::to_string(evaluation); });
+            }
+            if(evaluation >= beta) {
+                heuristics.cutoff(currentState, action, ply, previous, depth);
+                countCutoff(moveIndex);
+                storeTable(currentState, drawsBefore, ply, depth, beta, action, Bound::Lower);
+                return beta;
+            }
+            if(evaluation > alpha) {
+                alpha = evaluation;
+                nodeBest = action;
+                if(depth == maxDepth) bestAction = action;
+            }
+        }
+
+        if(first) {
+            return Score::lossIn(ply);
+        }
+
+        storeTable(currentState, drawsBefore, ply, depth, alpha, nodeBest, nodeBound(alphaOrig, alpha, beta));
         return alpha;
     }
 
-    double iterativeDeepening(GameState currentState, int maxDepth) {
-        const double inf = std::numeric_limits<double>::infinity();
+    // Quiescence search, run instead of the static evaluation at the horizon. It only
+    // plays captures, and the side to move may stand pat on the evaluation, unless its
+    // king is attacked : all actions are then searched so that the threat is answered.
+    // Fail-soft, and never stored in the table.
+    score_t quiescence(GameState& currentState, score_t alpha, score_t beta, int ply, int qply) {
+
+        if(currentState.hasWon(currentState.currentPlayer)) {
+            return Score::winIn(ply);
+        }
+        if(currentState.hasLost(currentState.currentPlayer)) {
+            return Score::lossIn(ply);
+        }
+        if(currentState.hasDraw()) {
+            ++nbDraws;
+            return drawScore;
+        }
+
+        if(stopped()) return 0;
+
+        const bool threatened = currentState.isKingAttacked() && qply > 0;
+        score_t standPat = -Score::infinity;
+        if(!threatened) {
+            ++stats.evaluations;
+            typename Agent::score score = agent.evaluate(currentState);
+            standPat = score.value(currentState.currentPlayer);
+            if(standPat >= beta || qply == 0 || !currentState.canCapture()) return standPat;
+            alpha = std::max(alpha, standPat);
+        }
+
+        std::optional<ActionOrdering> orderer;
+        if(threatened) orderer.emplace(currentState);
+        else orderer.emplace(currentState, typename ActionOrdering::Captures{});
+        Action action;
+        score_t bestEvaluation = standPat;
+        bool hasAction = false;
+
+        while(orderer->next(action)) {
+            hasAction = true;
+            if(deltaPruning && !threatened) {
+                const Piece victim = currentState.board.get(action.dst.idx());
+                const score_t optimistic = standPat + agent.captureValue(victim) + deltaMargin;
+                if(victim.type() != King && optimistic <= alpha) {
+                    // the returned bound must stay above what the skipped capture could reach
+                    bestEvaluation = std::max(bestEvaluation, optimistic);
+                    continue;
+                }
+            }
+            typename GameState::Undo undo;
+            [[maybe_unused]] bool validMove = currentState.apply(action, undo);
+            assert(validMove);
+            score_t evaluation = -quiescence(currentState, -beta, -alpha, ply+1, qply-1);
+            currentState.undo(undo);
+            if(aborted) return 0;
+            if(evaluation > bestEvaluation) bestEvaluation = evaluation;
+            if(evaluation >= beta) return evaluation;
+            if(evaluation > alpha) alpha = evaluation;
+        }
+
+        if(threatened && !hasAction) {
+            return Score::lossIn(ply);
+        }
+
+        return bestEvaluation;
+    }
+
+    // Memory-enhanced test : fail-soft null window search deciding whether the score
+    // reaches beta. Returns a lower bound of the score when it does, an upper bound otherwise.
+    score_t memoryTest(GameState& currentState, int maxDepth, int depth, score_t beta, const Action* hint) {
+
+        const int ply = maxDepth - depth;
+        if(currentState.hasWon(currentState.currentPlayer)) {
+            return Score::winIn(ply);
+        }
+        if(currentState.hasLost(currentState.currentPlayer)) {
+            return Score::lossIn(ply);
+        }
+        if(currentState.hasDraw()) {
+            ++nbDraws;
+            return drawScore;
+        }
+
+        if(depth == 0) {
+            return quiescence(currentState, beta-1, beta, ply, maxQuiescencePly);
+        }
+
+        if(stopped()) return 0;
+
+        if(ply > 0 && Score::lossIn(ply+2) >= beta) return Score::lossIn(ply+2);
+        if(ply > 0 && Score::winIn(ply+1) < beta) return Score::winIn(ply+1);
+
+        const unsigned long long drawsBefore = nbDraws;
+        std::optional<Action> ttAction;
+        ++stats.ttProbes;
+        if(const std::optional<typename TT::Probe> entry = tt->probe(currentState.hash())) {
+            ++stats.ttHits;
+            ttAction = entry->action;
+            if(depth != maxDepth && entry->depth >= depth && !repetitionRisk(currentState)) {
+                const score_t score = Score::fromTable(entry->score, ply);
+                if(entry->bound == Bound::Exact) return score;
+                if(entry->bound == Bound::Lower && score >= beta) return score;
+                if(entry->bound == Bound::Upper && score < beta) return score;
+            }
+        }
+        if(!hint && ttAction) hint = &*ttAction;
+
+        auto passSearch = [&](int reducedMaxDepth, int reducedDepth) {
+            return -memoryTest(currentState, reducedMaxDepth, reducedDepth, 1-beta, nullptr);
+        };
+        if(std::optional<score_t> nullScore = nullMoveCutoff(currentState, maxDepth, depth, beta, false, passSearch)) return *nullScore;
+        if(aborted) return 0;
+
+        const Action* previous = previousAction(ply);
+        const bool inCheck = currentState.isKingAttacked();
+        ActionOrdering orderer(currentState, hint, &heuristics, ply, previous);
+        Action action;
+        std::optional<Action> nodeBest;
+        score_t bestEvaluation = -Score::infinity;
+        int moveIndex = 0;
+
+        while(orderer.next(action)) {
+            const bool quiet = currentState.board.get(action.dst.idx()).empty();
+            typename GameState::Undo undo;
+            [[maybe_unused]] bool validMove = currentState.apply(action, undo);
+            assert(validMove);
+            pushLine(ply, action);
+            const int reduction = lateMoveReduction(currentState, maxDepth, depth, moveIndex++, quiet, inCheck);
+            score_t evaluation = -memoryTest(currentState, maxDepth-reduction, depth-1-reduction, 1-beta, nullptr);
+            if(reduction > 0 && evaluation >= beta && !aborted) {
+                evaluation = -memoryTest(currentState, maxDepth, depth-1, 1-beta, nullptr);
+            }
+            currentState.undo(undo);
+            if(aborted) return 0;
+            if(depth == maxDepth) {
+                Logger::log(Verb::Dev, [&](){ return action.toString() + " : " + std::to_string(evaluation); });
+            }
+            if(evaluation > bestEvaluation) {
+                bestEvaluation = evaluation;
+                nodeBest = action;
+            }
+            if(evaluation >= beta) {
+                if(depth == maxDepth) bestAction = action;
+                heuristics.cutoff(currentState, action, ply, previous, depth);
+                countCutoff(moveIndex);
+                storeTable(currentState, drawsBefore, ply, depth, evaluation, action, Bound::Lower);
+                return evaluation;
+            }
+        }
+
+        if(!nodeBest) {
+            return Score::lossIn(ply);
+        }
+
+        storeTable(currentState, drawsBefore, ply, depth, bestEvaluation, nodeBest, Bound::Upper);
+        return bestEvaluation;
+    }
+
+    // MTD(f) : narrows [lower, upper] around the score with null window tests, starting
+    // from a guess. The best action is the one of the last test that failed high.
+    score_t mtdf(GameState& currentState, int depth, score_t guess, const Action* hint) {
+        score_t lower = -Score::infinity;
+        score_t upper = Score::infinity;
+        score_t g = guess;
+        while(lower < upper) {
+            const score_t beta = (g == lower ? g+1 : g);
+            g = memoryTest(currentState, depth, depth, beta, hint);
+            if(aborted) return g;
+            if(g < beta) upper = g;
+            else lower = g;
+        }
+        return g;
+    }
+
+    // Young Brothers Wait Concept : the eldest child of a node is searched first, then
+    // its younger brothers become tasks of the pool, all with the window left by the
+    // eldest, and the first of them to fail high cancels the others. Tasks search a
+    // copy of the position with a fresh Minimax and no table, so the score and the
+    // action do not depend on the number of threads nor on the scheduling.
+    score_t youngBrothersSearch(GameState& currentState, int maxDepth, int depth, score_t alpha, score_t beta, const Action* hint) {
+
+        if(depth < splitDepth) {
+            return alphaBetaSearch(currentState, maxDepth, depth, alpha, beta);
+        }
+
+        const int ply = maxDepth - depth;
+        if(currentState.hasWon(currentState.currentPlayer)) {
+            return Score::winIn(ply);
+        }
+        if(currentState.hasLost(currentState.currentPlayer)) {
+            return Score::lossIn(ply);
+        }
+        if(currentState.hasDraw()) {
+            return drawScore;
+        }
+
+        if(stopped()) return 0;
+
+        const Action* previous = previousAction(ply);
+        ActionOrdering orderer(currentState, hint, &heuristics, ply, previous);
+        ActionSet actions;
+        Action action;
+        while(orderer.next(action)) actions.push_back(action);
+
+        if(actions.empty()) {
+            return Score::lossIn(ply);
+        }
+
+        // eldest brother
+        {
+            typename GameState::Undo undo;
+            [[maybe_unused]] bool validMove = currentState.apply(actions[0], undo);
+            assert(validMove);
+            pushLine(ply, actions[0]);
+            const score_t evaluation = -youngBrothersSearch(currentState, maxDepth, depth-1, -beta, -alpha, nullptr);
+            currentState.undo(undo);
+            if(aborted) return 0;
+            if(evaluation >= beta) {
+                heuristics.cutoff(currentState, actions[0], ply, previous, depth);
+                countCutoff(1);
+                return beta;
+            }
+            if(evaluation > alpha) {
+                alpha = evaluation;
+                if(depth == maxDepth) bestAction = actions[0];
+            }
+        }
+
+        // younger brothers
+        using History = std::remove_pointer_t<decltype(GameState::history)>;
+        const unsigned int nbActions = actions.size();
+        StopSignal cutoff(stopFlag);
+        std::atomic<bool> outOfTime(false);
+        std::vector<score_t> evaluations(nbActions, -Score::infinity);
+        std::vector<SearchStats> brotherStats(nbActions);
+        std::atomic<unsigned int> pending(nbActions-1);
+        for(unsigned int i = 1; i < nbActions; ++i) {
+            pool->submit([&, i]() {
+                if(!cutoff.raised()) {
+                    History history = (currentState.history ? *currentState.history : History());
+                    GameState state = currentState;
+                    if(currentState.history) state.history = &history;
+                    Agent brotherAgent = agent;
+                    Minimax brother(state, brotherAgent, nullptr);
+                    brother.stopFlag = &cutoff;
+                    brother.abortable = true;
+                    brother.limits = (abortable ? SearchLimits::moveTime(limits.milliseconds, limits.depth) : SearchLimits::fixedDepth(limits.depth));
+                    brother.start = start;
+                    brother.pool = pool;
+                    brother.line = line;
+                    typename GameState::Undo undo;
+                    [[maybe_unused]] bool validMove = state.apply(actions[i], undo);
+                    assert(validMove);
+                    brother.pushLine(ply, actions[i]);
+                    const score_t evaluation = -brother.youngBrothersSearch(state, maxDepth, depth-1, -beta, -alpha, nullptr);
+                    brotherStats[i] = brother.stats;
+                    brotherStats[i].nodes = brother.nbNodes;
+                    if(!brother.aborted) {
+                        evaluations[i] = evaluation;
+                        if(evaluation >= beta) cutoff.raise();
+                    } else if(!cutoff.raised()) {
+                        outOfTime.store(true, std::memory_order_relaxed);
+                        cutoff.raise();
+                    }
+                }
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+        while(pending.load(std::memory_order_acquire) > 0) {
+            if(!pool->runPending()) std::this_thread::yield();
+        }
+        for(const SearchStats& brotherStat : brotherStats) {
+            nbNodes += brotherStat.nodes; // stats.nodes is only set from nbNodes at the end
+            stats.add(brotherStat);
+        }
+
+        if(outOfTime.load(std::memory_order_relaxed) || (stopFlag && stopFlag->raised())) {
+            aborted = true;
+            return 0;
+        }
+        // which brother failed high first depends on the scheduling, so none is remembered
+        for(unsigned int i = 1; i < nbActions; ++i) {
+            if(evaluations[i] >= beta) {
+                countCutoff(i+1);
+                return beta;
+            }
+            if(evaluations[i] > alpha) {
+                alpha = evaluations[i];
+                if(depth == maxDepth) bestAction = actions[i];
+            }
+        }
+        return alpha;
+    }
+
+    // Searches with a window centered on the score of the previous iteration, widened
+    // on the failing side until the score falls inside. Decided scores get the full window.
+    score_t aspirationSearch(GameState& currentState, int depth, score_t previousScore, Action* hint) {
+        const score_t inf = Score::infinity;
+        auto searchWindow = [&](score_t alpha, score_t beta) {
+            if(mode == PrincipalVariation) return principalVariationSearch(currentState, depth, depth, alpha, beta, hint);
+            return alphaBetaSearchWithHint(currentState, depth, depth, alpha, beta, hint);
+        };
+        if(depth == 0 || Score::isDecided(previousScore)) {
+            return searchWindow(-inf, inf);
+        }
+        score_t delta = aspirationWindow;
+        score_t alpha = previousScore - delta;
+        score_t beta = previousScore + delta;
+        while(true) {
+            const score_t score = searchWindow(alpha, beta);
+            if(aborted) return score;
+            if(score <= alpha && alpha > -inf) {
+                delta *= 2;
+                alpha = (previousScore - delta > Score::lossBound ? previousScore - delta : -inf);
+            } else if(score >= beta && beta < inf) {
+                delta *= 2;
+                beta = (previousScore + delta < Score::winBound ? previousScore + delta : inf);
+            } else {
+                return score;
+            }
+            Logger::log(Verb::Dev, [&](){
+                return "Aspiration window widened to [" + std::to_string(alpha) + ", " + std::to_string(beta) + "]";
+            });
+        }
+    }
+
+    score_t iterativeDeepening(GameState& currentState, int maxDepth) {
+        const score_t inf = Score::infinity;
         std::optional<Action> currentBest;
         bestAction.reset();
-        double bestScore = -inf;
-        for(int depth = 0; depth < maxDepth; ++depth) {
+        score_t bestScore = -inf;
+        for(int depth = std::max(0, std::min(firstDepth, maxDepth-1)); depth < maxDepth; ++depth) {
             Action hintAction;
             if(currentBest.has_value()) hintAction = currentBest.value();
             Action* hint = (currentBest.has_value() ? &hintAction : nullptr);
             Logger::log(Verb::Dev, [&](){
                 return R"(Current hint is : )" + (hint ? hint->toString() : "none");    
             });
-            bestScore = alphaBetaSearchWithHint(currentState, depth, depth, -inf, inf, hint);
+            const unsigned long long nodesBefore = nbNodes;
+            const double millisecondsBefore = elapsedMilliseconds();
+            score_t score = 0;
+            if(mode == MTDf) {
+                score = mtdf(currentState, depth, (bestScore == -inf ? 0 : bestScore), hint);
+            } else if(mode == YoungBrothers) {
+                score = youngBrothersSearch(currentState, depth, depth, -inf, inf, hint);
+            } else {
+                score = aspirationSearch(currentState, depth, bestScore, hint);
+            }
+            stats.iterations.push_back({depth, nbNodes - nodesBefore, elapsedMilliseconds() - millisecondsBefore, score, !aborted});
+            // an interrupted depth is dropped in favor of the last completed one
+            if(aborted) {
+                if(currentBest) bestAction = currentBest;
+                break;
+            }
+            bestScore = score;
             currentBest = bestAction;
-            if(bestScore == std::numeric_limits<double>::infinity()) break;
+            if(currentBest) abortable = true;
+            // deeper searches would only find the same end of the game further away
+            if(Score::isDecided(bestScore) && currentBest) break;
         }
         return bestScore;
     }
@@ -0,0 +1,106 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+#include "minimax.h"
+#include "searchlimits.h"
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+// Pondering : while the opponent thinks, a background search runs on the position
+// after the reply the engine expects. When the opponent plays that reply (a ponder
+// hit), the engine waits for that search, usually already done, and plays its action.
+// Any other reply aborts it, and the engine searches as usual, with a table warmed
+// up by the aborted search.
+// Without thread support (emscripten builds), start does nothing and every reply misses.
+template<Mode mode, typename Action, typename ActionSet, typename GameState, typename Agent, typename ActionOrdering>
+struct Ponder {
+
+    using Search = Minimax<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    using TT = typename Search::TT;
+    using History = std::remove_pointer_t<decltype(GameState::history)>;
+
+    TT* tt;
+    History history;
+    std::optional<GameState> state;
+    std::optional<Agent> agent;
+    std::optional<Action> expected;
+    std::optional<Action> bestAction;
+    std::optional<Action> reply; // expected by the pondered search to its own action
+    score_t score;
+    StopSignal stop;
+    std::thread thread;
+
+
+    explicit Ponder(TT* tt = nullptr) :
+        tt(tt),
+        history(),
+        state(),
+        agent(),
+        expected(),
+        bestAction(),
+        reply(),
+        score(0),
+        stop(),
+        thread()
+    { }
+
+    ~Ponder() {
+        abort();
+    }
+
+    Ponder(const Ponder&) = delete;
+    Ponder& operator=(const Ponder&) = delete;
+
+    // searches, in the background, position after the expected reply
+    void start(const GameState& position, const Action& expectedReply, const Agent& searchAgent, const SearchLimits& limits) {
+        abort();
+#ifndef __EMSCRIPTEN__
+        if(position.history) history = *position.history;
+        state.emplace(position);
+        if(position.history) state->history = &history;
+        if(!state->checkAction(expectedReply)) return;
+        state->apply(expectedReply);
+        if(state->gameOver()) return;
+        agent.emplace(searchAgent);
+        expected = expectedReply;
+        bestAction.reset();
+        reply.reset();
+        stop.flag.store(false, std::memory_order_relaxed);
+        thread = std::thread([this, limits]() {
+            Search search(*state, *agent, tt);
+            search.stopFlag = &stop;
+            score = search.run(limits);
+            if(search.aborted) return;
+            bestAction = search.bestAction;
+            reply = search.expectedReply();
+        });
+#endif
+    }
+
+    // the opponent played : returns the action of the pondered search on a hit
+    std::optional<Action> hit(const Action& played) {
+        if(!thread.joinable()) return std::nullopt;
+        if(!expected || !(played == *expected)) {
+            abort();
+            return std::nullopt;
+        }
+        thread.join();
+        expected.reset();
+        return bestAction;
+    }
+
+    void abort() {
+        if(thread.joinable()) {
+            stop.raise();
+            thread.join();
+        }
+        expected.reset();
+        bestAction.reset();
+        reply.reset();
+    }
+
+};
+
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <cstdint>
+
+// Search scores are plain integers. Evaluations are expected to stay well
+// inside ]loss, win[ so that won and lost positions always compare beyond them,
+// and infinity is only used as an initial search bound.
+using score_t = int32_t;
+
+// A game that ends ply plies away from the root of a search scores win - ply or
+// loss + ply, so that faster wins and slower losses are preferred. Scores beyond
+// winBound or lossBound are such decided games.
+struct Score {
+    static constexpr score_t infinity = 1000000000;
+    static constexpr score_t win = 100000000;
+    static constexpr score_t loss = -win;
+
+    static constexpr int maxMatePly = 1000;
+    static constexpr score_t winBound = win - maxMatePly;
+    static constexpr score_t lossBound = -winBound;
+
+    static_assert(win < infinity);
+
+    static constexpr score_t winIn(int ply) { return win - ply; }
+    static constexpr score_t lossIn(int ply) { return loss + ply; }
+
+    static constexpr bool isWin(score_t s) { return s >= winBound; }
+    static constexpr bool isLoss(score_t s) { return s <= lossBound; }
+    static constexpr bool isDecided(score_t s) { return isWin(s) || isLoss(s); }
+
+    // moves of the side to move before the end of the game : positive when it wins,
+    // negative when it loses, 0 when the score is not decided
+    static constexpr int movesToEnd(score_t s) {
+        if(isWin(s)) return (win - s + 1) / 2;
+        if(isLoss(s)) return -((s - loss + 1) / 2);
+        return 0;
+    }
+
+    // transposition tables store decided scores relative to the stored node
+    static constexpr score_t toTable(score_t s, int ply) {
+        return isWin(s) ? s + ply : (isLoss(s) ? s - ply : s);
+    }
+
+    static constexpr score_t fromTable(score_t s, int ply) {
+        return isWin(s) ? s - ply : (isLoss(s) ? s + ply : s);
+    }
+};
+
+#endif
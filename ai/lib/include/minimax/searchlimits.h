@@ -0,0 +1,76 @@
+#ifndef SEARCHLIMITS_H
+#define SEARCHLIMITS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// Bounds of one search. Time and node limits are checked every few nodes and
+// stop iterative searches, which then play the best action of the last
+// completed depth. A zero time or node limit means no limit.
+struct SearchLimits {
+    int depth;
+    long long milliseconds;
+    unsigned long long nodes;
+
+    static SearchLimits fixedDepth(int depth) { return SearchLimits{depth, 0, 0}; }
+
+    static SearchLimits moveTime(long long milliseconds, int maxDepth) { return SearchLimits{maxDepth, milliseconds, 0}; }
+
+    bool timed() const { return milliseconds > 0 || nodes > 0; }
+};
+
+// Stop request shared between threads. A signal is also raised when any of its
+// parents is, so cancelling a search cancels everything it started.
+struct StopSignal {
+    std::atomic<bool> flag;
+    const StopSignal* parent;
+
+    explicit StopSignal(const StopSignal* parent = nullptr) :
+        flag(false),
+        parent(parent)
+    { }
+
+    void raise() { flag.store(true, std::memory_order_relaxed); }
+
+    bool raised() const {
+        for(const StopSignal* s = this; s; s = s->parent) {
+            if(s->flag.load(std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+};
+
+// Time budget of a player for a whole game, shared out between its moves.
+// Each move gets an even share of what remains for the moves still to come,
+// so that an early long think does not starve the end of the game.
+struct GameClock {
+
+    using clock = std::chrono::steady_clock;
+
+    static constexpr int minMovesToGo = 10;
+    static constexpr int maxMovesToGo = 40;
+
+    long long remaining; // milliseconds
+    clock::time_point started;
+
+    explicit GameClock(long long milliseconds) :
+        remaining(milliseconds),
+        started()
+    { }
+
+    // limits for the next move, when movesLeft moves of this player remain at most
+    SearchLimits nextMove(int movesLeft, int maxDepth) const {
+        const int movesToGo = std::clamp(movesLeft, minMovesToGo, maxMovesToGo);
+        return SearchLimits::moveTime(std::max(1LL, remaining / movesToGo), maxDepth);
+    }
+
+    void start() { started = clock::now(); }
+
+    void stop() {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - started);
+        remaining = std::max(0LL, remaining - (long long)elapsed.count());
+    }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include "score.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// What one search did, filled by Minimax while it searches. Nodes are the nodes
+// entered by the search, quiescence included, and evaluations the calls to the
+// agent. Cutoffs are only counted at full width nodes.
+struct SearchStats {
+
+    // one depth of an iterative search, only the last one may have been interrupted
+    struct Iteration {
+        int depth;
+        unsigned long long nodes;
+        double milliseconds;
+        score_t score;
+        bool completed;
+    };
+
+    std::vector<Iteration> iterations;
+    unsigned long long nodes = 0;
+    unsigned long long evaluations = 0;
+    unsigned long long cutoffs = 0;
+    unsigned long long firstMoveCutoffs = 0;
+    unsigned long long ttProbes = 0;
+    unsigned long long ttHits = 0;
+    double milliseconds = 0;
+
+
+    // share of the cutoffs produced by the first action searched, the closer to 1
+    // the better the ordering
+    double firstMoveCutoffRate() const {
+        return cutoffs ? double(firstMoveCutoffs) / double(cutoffs) : 0.0;
+    }
+
+    // nodes of the last completed iteration over nodes of the one before
+    double effectiveBranchingFactor() const {
+        size_t n = iterations.size();
+        if(n > 0 && !iterations[n-1].completed) --n;
+        if(n < 2 || iterations[n-2].nodes == 0) return 0.0;
+        return double(iterations[n-1].nodes) / double(iterations[n-2].nodes);
+    }
+
+    double nodesPerSecond() const {
+        return milliseconds > 0 ? 1000.0 * double(nodes) / milliseconds : 0.0;
+    }
+
+    // counters of a search that worked on a part of this one
+    void add(const SearchStats& other) {
+        nodes += other.nodes;
+        evaluations += other.evaluations;
+        cutoffs += other.cutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+    }
+
+    std::string toJson() const {
+        std::string s = "{";
+        s += "\"nodes\":" + std::to_string(nodes);
+        s += ",\"evaluations\":" + std::to_string(evaluations);
+        s += ",\"milliseconds\":" + decimal(milliseconds);
+        s += ",\"nodesPerSecond\":" + decimal(nodesPerSecond());
+        s += ",\"cutoffs\":" + std::to_string(cutoffs);
+        s += ",\"firstMoveCutoffRate\":" + decimal(firstMoveCutoffRate());
+        s += ",\"effectiveBranchingFactor\":" + decimal(effectiveBranchingFactor());
+        s += ",\"ttProbes\":" + std::to_string(ttProbes);
+        s += ",\"ttHits\":" + std::to_string(ttHits);
+        s += ",\"iterations\":[";
+        for(size_t i = 0; i < iterations.size(); ++i) {
+            const Iteration& it = iterations[i];
+            if(i > 0) s += ',';
+            s += "{\"depth\":" + std::to_string(it.depth);
+            s += ",\"nodes\":" + std::to_string(it.nodes);
+            s += ",\"milliseconds\":" + decimal(it.milliseconds);
+            s += ",\"score\":" + std::to_string(it.score);
+            s += ",\"completed\":" + std::string(it.completed ? "true" : "false") + "}";
+        }
+        s += "]}";
+        return s;
+    }
+
+private:
+
+    static std::string decimal(double d) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", d);
+        return buffer;
+    }
+
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include "score.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cassert>
+#include <limits>
+#include <optional>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#define TT_USE_MMAP 1
+#else
+#define TT_USE_MMAP 0
+#endif
+
+enum class Bound : uint8_t {
+    None,
+    Exact,
+    Lower, // the score is at least the stored one
+    Upper  // the score is at most the stored one
+};
+
+// Fixed-size transposition table, made of cache-line sized buckets of 4 entries.
+// Each entry is two 64-bit words : the payload (score, move, depth, bound, generation)
+// and the position key xored with the payload, so a torn entry never verifies.
+// Both words are relaxed atomics : threads share the table without any lock.
+// Actions are stored through their 16 bit Action::pack() encoding.
+template<typename Action>
+struct TranspositionTable {
+
+    static constexpr size_t entriesPerBucket = 4;
+
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    struct alignas(64) Bucket {
+        Entry entries[entriesPerBucket];
+    };
+
+    static_assert(sizeof(Bucket) == 64);
+
+    struct Probe {
+        score_t score;
+        std::optional<Action> action;
+        int depth;
+        Bound bound;
+    };
+
+#ifdef __EMSCRIPTEN__
+    static constexpr size_t defaultMegabytes = 8;
+#else
+    static constexpr size_t defaultMegabytes = 64;
+#endif
+
+    explicit TranspositionTable(size_t megabytes = defaultMegabytes) :
+        buckets(nullptr),
+        nbBuckets(0),
+        bytes(0),
+        mapped(false),
+        generation(0)
+    {
+        resize(megabytes);
+    }
+
+    ~TranspositionTable() { release(); }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // the number of buckets is rounded down to a power of two, and halved as long as
+    // that much memory cannot be allocated
+    void resize(size_t megabytes) {
+        release();
+        size_t n = 1;
+        while(2*n*sizeof(Bucket) <= (megabytes << 20)) n *= 2;
+        while(!allocate(n)) {
+            if(n == 1) std::abort(); // not even one bucket
+            n /= 2;
+        }
+        clear();
+    }
+
+    void clear() {
+        for(size_t i = 0; i < nbBuckets; ++i) {
+            for(Entry& e : buckets[i].entries) {
+                e.check.store(0, std::memory_order_relaxed);
+                e.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation.store(0, std::memory_order_relaxed);
+    }
+
+    // called once per search so that entries of older searches get replaced first
+    void newSearch() { generation.store((generation.load(std::memory_order_relaxed) + 1) & generationMask, std::memory_order_relaxed); }
+
+    std::optional<Probe> probe(uint64_t key) const {
+        const Bucket& bucket = buckets[key & (nbBuckets-1)];
+        for(const Entry& e : bucket.entries) {
+            const uint64_t data = e.data.load(std::memory_order_relaxed);
+            const uint64_t check = e.check.load(std::memory_order_relaxed);
+            if((check ^ data) != key || boundOf(data) == Bound::None) continue;
+            Probe p;
+            p.score = scoreOf(data);
+            const uint16_t packed = moveOf(data);
+            if(packed != 0) p.action = Action::unpack(packed);
+            p.depth = depthOf(data);
+            p.bound = boundOf(data);
+            return p;
+        }
+        return std::nullopt;
+    }
+
+    void store(uint64_t key, score_t score, const std::optional<Action>& action, int depth, Bound bound) {
+        assert(depth >= 0 && depth <= 0xFF);
+        Bucket& bucket = buckets[key & (nbBuckets-1)];
+        const uint8_t currentGeneration = generation.load(std::memory_order_relaxed);
+        Entry* replaced = &bucket.entries[0];
+        uint64_t replacedData = replaced->data.load(std::memory_order_relaxed);
+        bool sameKey = false;
+        int worst = std::numeric_limits<int>::max();
+        for(Entry& e : bucket.entries) {
+            const uint64_t data = e.data.load(std::memory_order_relaxed);
+            sameKey = ((e.check.load(std::memory_order_relaxed) ^ data) == key);
+            if(sameKey || boundOf(data) == Bound::None) {
+                replaced = &e;
+                replacedData = data;
+                break;
+            }
+            // prefer replacing shallow entries from older searches
+            const int age = (currentGeneration - generationOf(data)) & generationMask;
+            const int value = depthOf(data) - 4*age;
+            if(value < worst) {
+                worst = value;
+                replaced = &e;
+                replacedData = data;
+            }
+        }
+        uint16_t packed = (action ? action->pack() : 0);
+        if(!action && sameKey) packed = moveOf(replacedData);
+        const uint64_t data = uint64_t(uint32_t(score))
+                            | (uint64_t(packed) << 32)
+                            | (uint64_t(depth) << 48)
+                            | (uint64_t(bound) << 56)
+                            | (uint64_t(currentGeneration) << 58);
+        replaced->data.store(data, std::memory_order_relaxed);
+        replaced->check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return nbBuckets*entriesPerBucket; }
+
+private:
+
+    static constexpr uint8_t generationMask = 0x3F;
+
+    static score_t scoreOf(uint64_t data) { return score_t(uint32_t(data)); }
+    static uint16_t moveOf(uint64_t data) { return uint16_t(data >> 32); }
+    static int depthOf(uint64_t data) { return int((data >> 48) & 0xFF); }
+    static Bound boundOf(uint64_t data) { return Bound((data >> 56) & 0x3); }
+    static uint8_t generationOf(uint64_t data) { return uint8_t(data >> 58) & generationMask; }
+
+    bool allocate(size_t n) {
+        nbBuckets = n;
+        bytes = n*sizeof(Bucket);
+#if TT_USE_MMAP
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(mem == MAP_FAILED) {
+            mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(mem != MAP_FAILED) madvise(mem, bytes, MADV_HUGEPAGE);
+        }
+        if(mem != MAP_FAILED) {
+            buckets = static_cast<Bucket*>(mem);
+            mapped = true;
+            return true;
+        }
+#endif
+        buckets = static_cast<Bucket*>(std::aligned_alloc(alignof(Bucket), bytes));
+        mapped = false;
+        return buckets != nullptr;
+    }
+
+    void release() {
+        if(!buckets) return;
+#if TT_USE_MMAP
+        if(mapped) munmap(buckets, bytes);
+        else std::free(buckets);
+#else
+        std::free(buckets);
+#endif
+        buckets = nullptr;
+    }
+
+    Bucket* buckets;
+    size_t nbBuckets;
+    size_t bytes;
+    bool mapped;
+    std::atomic<uint8_t> generation;
+
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where each thread owns a task queue. A thread pushes and pops
+// its own tasks at the back, and steals the oldest tasks of the others at
+// the front when its queue is empty. Queue 0 belongs to the threads outside the
+// pool. Threads waiting for tasks to complete are expected to keep calling
+// runPending(), so that a pool without workers still gets every task done.
+struct WorkStealingPool {
+
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned int nbWorkers) :
+        queues(),
+        workers(),
+        done(false)
+    {
+        for(unsigned int i = 0; i <= nbWorkers; ++i) queues.push_back(std::make_unique<Queue>());
+#ifndef __EMSCRIPTEN__
+        for(unsigned int i = 1; i <= nbWorkers; ++i) {
+            workers.emplace_back([this, i]() {
+                owner = this;
+                current = i;
+                while(!done.load(std::memory_order_relaxed)) {
+                    if(!runPending()) std::this_thread::yield();
+                }
+            });
+        }
+#endif
+    }
+
+    ~WorkStealingPool() {
+        done.store(true, std::memory_order_relaxed);
+        for(std::thread& worker : workers) worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task) {
+        Queue& queue = *queues[ownQueue()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // runs one task, from the own queue first, returns false when there was none
+    bool runPending() {
+        const unsigned int own = ownQueue();
+        Task task;
+        if(pop(*queues[own], task, true)) {
+            task();
+            return true;
+        }
+        for(unsigned int i = 1; i < queues.size(); ++i) {
+            if(pop(*queues[(own + i) % queues.size()], task, false)) {
+                task();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<bool> done;
+
+    static inline thread_local const WorkStealingPool* owner = nullptr;
+    static inline thread_local unsigned int current = 0;
+
+    unsigned int ownQueue() const { return owner == this ? current : 0; }
+
+    static bool pop(Queue& queue, Task& task, bool back) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.tasks.empty()) return false;
+        if(back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+
+};
+
+
+#endif
@@ -6,6 +6,7 @@
 #include "gamestate.h"
 #include "agent.h"
 #include "minimax/minimax.h"
+#include "minimax/engine.h"
 #include <cstring>
 
 extern "C" {
@@ -40,7 +41,7 @@ extern "C" {
 
         GameHistory history;
         GameState state(&history, board, reserve0, reserve1, (Color)player);
-        Action action { p, type, src, dst };
+        Action action = (type == ActionType::Drop ? Action::drop(p, dst) : Action::move(p, src, dst));
         bool check = state.checkAction(action);
 
         return check;
@@ -66,7 +67,7 @@ extern "C" {
 
         GameHistory history;
         GameState state(&history, board, reserve0, reserve1, (Color)player);
-        Action action { p, type, src, dst };
+        Action action = (type == ActionType::Drop ? Action::drop(p, dst) : Action::move(p, src, dst));
         state.apply(action);
 
         init();
@@ -78,6 +79,62 @@ extern "C" {
         return 1;
     }
 
+}
+
+// depth bound of timed searches, which normally stop on time long before
+static constexpr int maxTimedDepth = 20;
+
+// threads of every search, see setSearchThreads
+static unsigned int nbThreads = 1;
+
+// end of the game found by the last search, see searchMovesToEnd
+static int movesToEnd = 0;
+
+// game of the following searches, see newGame
+static unsigned int gameNumber = 0;
+
+template<Mode mode>
+static int searchWithMode(
+    const char* board,
+    const char* reserve0,
+    const char* reserve1,
+    int player,
+    SearchLimits limits
+) {
+    if(player < 0) player = 0;
+    if(player > 1) player = 1;
+
+    // kept between calls : the tables, and the game as long as the positions given
+    // follow each other by one action
+    static Engine<mode, Action, ActionSet, GameState, Agent, ActionOrdering> engine;
+    static unsigned int engineGame = 0;
+
+    if(engineGame != gameNumber) {
+        engine.newGame(board, reserve0, reserve1, (Color)player);
+        engineGame = gameNumber;
+    } else {
+        engine.follow(board, reserve0, reserve1, (Color)player);
+    }
+    engine.nbThreads = nbThreads;
+
+    std::optional<Action> action = engine.search(limits);
+    movesToEnd = Score::movesToEnd(engine.score);
+    if(action) {
+        engine.play(action.value());
+    }
+    const GameState& state = engine.state;
+
+    init();
+    
+    std::strcpy(board_buffer, state.board.toString().c_str());
+    std::strcpy(reserve0_buffer, state.reserve0.toString().c_str());
+    std::strcpy(reserve1_buffer, state.reserve1.toString().c_str());
+
+    return action.has_value();
+}
+
+extern "C" {
+
     int searchBestMove(
         const char* board,
         const char* reserve0,
@@ -85,33 +142,54 @@ extern "C" {
         int player,
         int depth
     ) {
-        if(player < 0) player = 0;
-        if(player > 1) player = 1;
-
         if(depth < 1) depth = 1;
         if(depth > 8) depth = 8;
+        return searchWithMode<Mode::IterativeDeepening>(board, reserve0, reserve1, player, SearchLimits::fixedDepth(depth));
+    }
 
-        GameHistory history;
-        GameState state(&history, board, reserve0, reserve1, (Color)player);
+    int searchBestMoveMTDf(
+        const char* board,
+        const char* reserve0,
+        const char* reserve1,
+        int player,
+        int depth
+    ) {
+        if(depth < 1) depth = 1;
+        if(depth > 8) depth = 8;
+        return searchWithMode<Mode::MTDf>(board, reserve0, reserve1, player, SearchLimits::fixedDepth(depth));
+    }
 
-        Agent agent;
-        using MyMinimax = Minimax<Mode::IterativeDeepening, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    // searches for at most the given time in milliseconds and, when positive, the given
+    // number of nodes, then plays the best action of the deepest completed iteration
+    int searchBestMoveTimed(
+        const char* board,
+        const char* reserve0,
+        const char* reserve1,
+        int player,
+        int milliseconds,
+        int nodes
+    ) {
+        if(milliseconds < 1) milliseconds = 1;
+        SearchLimits limits = SearchLimits::moveTime(milliseconds, maxTimedDepth);
+        if(nodes > 0) limits.nodes = nodes;
+        return searchWithMode<Mode::PrincipalVariation>(board, reserve0, reserve1, player, limits);
+    }
 
-        std::optional<Action> action;
-        MyMinimax search(state, agent);
-        search.run(depth);
-        action = search.bestAction;
-        if(action) {
-            state.apply(action.value());
-        } 
+    // moves before the end of the game found by the last search, for the player that
+    // searched : positive when it wins, negative when it loses, 0 when undecided
+    int searchMovesToEnd() {
+        return movesToEnd;
+    }
 
-        init();
-        
-        std::strcpy(board_buffer, state.board.toString().c_str());
-        std::strcpy(reserve0_buffer, state.reserve0.toString().c_str());
-        std::strcpy(reserve1_buffer, state.reserve1.toString().c_str());
+    // forgets what the searches learned, to be called before the first search of a game
+    void newGame() {
+        ++gameNumber;
+    }
 
-        return action.has_value();
+    // number of threads of the following searches, ignored by builds without threads
+    void setSearchThreads(int threads) {
+        if(threads < 1) threads = 1;
+        nbThreads = threads;
     }
 
     const char* board() {
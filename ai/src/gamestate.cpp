@@ -1,7 +1,6 @@
 #include "gamestate.h"
 #include "gamelogic.h"
 #include <algorithm>
-#include <bitset>
 
 bool GameState::checkMove(Piece p, Pos a, Pos b) const {
     if(nbTurns >= maxTurns) return false;
@@ -24,7 +23,7 @@ bool GameState::checkMove(Piece p, Pos a, Pos b) const {
     return allowedOffset(p, a, b);
 }
 
-bool GameState::checkDrop(Piece p, Pos res, Pos a) const {
+bool GameState::checkDrop(Piece p, Pos a) const {
     if(nbTurns >= maxTurns) return false;
     if(hasWinner()) return false;
     if(a.valid() == false) return false;
@@ -33,28 +32,11 @@ bool GameState::checkDrop(Piece p, Pos res, Pos a) const {
     const Color c = p.color();
     const PieceType pt = p.type();
     if(pt == NoType) return false;
+    if(pt == King || pt == Queen) return false;
     if(c != P0 && c != P1) return false;
     if(c != currentPlayer) return false;
-    if(c == P0) {
-        auto pos = std::find_if(reserve0.begin(), reserve0.end(), [&](Piece p) { return p.type() == pt; });
-        if(pos == reserve0.end()) return false;
-        uint8_t posInReserve = std::distance(reserve0.begin(), pos);
-        if(posInReserve >= reserve0.size) return false;
-        const Piece src = reserve0[posInReserve];
-        if(src.type() != pt) return false;
-        if(src.color() != c) return false;
-        if(src.type() == King || src.type() == Queen) return false;
-    }
-    if(c == P1) {
-        auto pos = std::find_if(reserve1.begin(), reserve1.end(), [&](Piece p) { return p.type() == pt; });
-        if(pos == reserve1.end()) return false;
-        uint8_t posInReserve = std::distance(reserve1.begin(), pos);
-        if(posInReserve >= reserve1.size) return false;
-        const Piece src = reserve1[posInReserve];
-        if(src.type() != pt) return false;
-        if(src.color() != c) return false;
-        if(src.type() == King || src.type() == Queen) return false;
-    }
+    if(c == P0 && !reserve0.has(pt)) return false;
+    if(c == P1 && !reserve1.has(pt)) return false;
     return true;
 }
 
@@ -94,10 +76,7 @@ bool GameState::allowedOffset(Piece p, Pos a, Pos b) {
     const PieceType pt = p.type();
     assert(c == P0 || c == P1);
     assert(pt != NoType);
-    auto& movesets = GameLogic::moveSets(p);
-    auto& moveset = movesets[a.idx()];
-    return std::find(moveset.begin(), moveset.end(), b.idx()) != moveset.end();
-
+    return MoveMasks::allMasks[c][pt][a.idx()][b.idx()];
 }
 
 bool GameState::move(Piece p, Pos a, Pos b) {
@@ -107,15 +86,20 @@ bool GameState::move(Piece p, Pos a, Pos b) {
     Piece dst = board.get(b.idx());
     Color c = p.color();
     if(dst.empty() == false) {
+        dst.demote();
+        const PieceType pt = dst.type();
         if(c == P0) {
-            dst.demote();
+            const uint8_t n = reserve0.count(pt);
+            zobrist ^= Zobrist::reserve(P0, pt, n) ^ Zobrist::reserve(P0, pt, n+1);
             reserve0.push(dst);
         } else {
-            dst.demote();
+            const uint8_t n = reserve1.count(pt);
+            zobrist ^= Zobrist::reserve(P1, pt, n) ^ Zobrist::reserve(P1, pt, n+1);
             reserve1.push(dst);
         }
+        analysis.addReserve(Piece(pt, c));
     }
-    board.set(a.idx(), Piece());
+    setSquare(a.idx(), Piece());
     constexpr unsigned int rows = GameConfig::rows;
     constexpr unsigned int cols = GameConfig::cols;
     if(c == P0 && b.idx()/cols == rows-1) {
@@ -124,58 +108,41 @@ bool GameState::move(Piece p, Pos a, Pos b) {
     if(c == P1 && b.idx()/cols == 0) {
         src.promote();
     }
-    board.set(b.idx(), src);
+    setSquare(b.idx(), src);
     swapPlayer();
     return true;
 }
 
-bool GameState::allowedDrop(Piece p, uint8_t& posInReserve, Pos a) const {
+bool GameState::allowedDrop(Piece p, Pos a) const {
     assert(a.valid());
     Color c = p.color();
     PieceType pt = p.type();
     assert(c == P0 || c == P1);
     assert(pt != NoType);
+    assert(pt != King);
+    assert(pt != Queen);
     assert(!hasWinner());
     const Piece dst = board.get(a.idx());
     if(dst.empty() == false) return false;
-    if(c == P0) {
-        auto pos = std::find_if(reserve0.begin(), reserve0.end(), [&](Piece p) { return p.type() == pt; });
-        if(pos == reserve0.end()) return false;
-        posInReserve = std::distance(reserve0.begin(), pos);
-#ifndef NDEBUG
-        const Piece src = reserve0[posInReserve];
-        assert(src.type() == pt);
-        assert(src.color() == c);
-        assert(src.type() != King);
-        assert(src.type() != Queen);
-#endif
-    } else {
-        auto pos = std::find_if(reserve1.begin(), reserve1.end(), [&](Piece p) { return p.type() == pt; });
-        if(pos == reserve1.end()) return false;
-        posInReserve = std::distance(reserve1.begin(), pos);
-#ifndef NDEBUG
-        const Piece src = reserve1[posInReserve];
-        assert(src.type() == pt);
-        assert(src.color() == c);
-        assert(src.type() != King);
-        assert(src.type() != Queen);
-#endif
-    }
-    return true;
+    if(c == P0) return reserve0.has(pt);
+    return reserve1.has(pt);
 }
 
-bool GameState::drop(Piece p, Pos res, Pos dst) {
-    uint8_t posInReserve = res.idx();
-    assert(allowedDrop(p, posInReserve, dst.idx()));
+bool GameState::drop(Piece p, Pos dst) {
+    assert(allowedDrop(p, dst.idx()));
     const Color c = p.color();
+    const PieceType pt = p.type();
     if(c == P0) {
-        const Piece src = reserve0.pop(res.idx());
-        board.set(dst.idx(), src);
+        const uint8_t n = reserve0.count(pt);
+        zobrist ^= Zobrist::reserve(P0, pt, n) ^ Zobrist::reserve(P0, pt, n-1);
+        setSquare(dst.idx(), reserve0.pop(pt));
     }
     if(c == P1) {
-        const Piece src = reserve1.pop(res.idx());
-        board.set(dst.idx(), src);
+        const uint8_t n = reserve1.count(pt);
+        zobrist ^= Zobrist::reserve(P1, pt, n) ^ Zobrist::reserve(P1, pt, n-1);
+        setSquare(dst.idx(), reserve1.pop(pt));
     }
+    analysis.removeReserve(p);
     swapPlayer();
     return true;
 }
@@ -187,47 +154,52 @@ void GameState::fillAllowedActions(ActionSet* actions) const {
     if(hasWon(currentPlayer) || hasLost(currentPlayer)) return;
     if(nbTurns >= maxTurns) return;
 
-    constexpr unsigned int rows = GameConfig::rows;
-    constexpr unsigned int cols = GameConfig::cols;
+    appendMoves(actions, ~board.occupied(currentPlayer));
+    appendDrops(actions);
+}
 
-    for(Pos::value i = 0; i < rows*cols; ++i) {
-        const Piece p = board.get(i);
-        const Pos src(i);
-        if(p.color() != currentPlayer) continue;
-        for(Pos dst : GameLogic::moveSet(p, src)) {
-            if(dst.valid() == false) continue;
-            if(allowedMove(p, src, dst) == false) continue;
-            actions->push_back(Action::move(p, src, dst));
-        }
-    }
-    if(currentPlayer == P0) {
-        std::bitset<NB_PIECE_TYPE+1> typeVisited(false);
-        uint8_t dummyPos = 0;
-        for(uint8_t k = 0; k < reserve0.size; ++k) {
-            const Piece p = reserve0[k];
-            if(typeVisited[p.type()]) continue;
-            typeVisited[p.type()] = 1;
-            for(Pos::value i = 0; i < rows*cols; ++i) {
-                const Pos dst(i);
-                if(dst.valid() == false) continue;
-                if(allowedDrop(p, dummyPos, dst) == false) continue;
-                actions->push_back(Action::drop(p, dummyPos, dst));
-            }
-        }
+void GameState::fillCaptures(ActionSet* actions) const {
+    actions->clear();
+    if(hasWinner() || nbTurns >= maxTurns) return;
+    appendMoves(actions, board.occupied(currentPlayer == P0 ? P1 : P0));
+}
+
+void GameState::fillQuietMoves(ActionSet* actions) const {
+    actions->clear();
+    if(hasWinner() || nbTurns >= maxTurns) return;
+    appendMoves(actions, board.empty());
+}
+
+void GameState::fillDrops(ActionSet* actions) const {
+    actions->clear();
+    if(hasWinner() || nbTurns >= maxTurns) return;
+    appendDrops(actions);
+}
+
+void GameState::appendMoves(ActionSet* actions, mask_t allowedTargets) const {
+    const Color c = currentPlayer;
+    const mask_t own = board.occupied(c);
+    allowedTargets &= ~own;
+
+    // squares are visited in increasing order, only occupied ones are looked at
+    for(mask_t sources = own; sources.any();) {
+        const Pos src(sources.popFirst());
+        const Piece p = board.get(src.idx());
+        mask_t targets = MoveMasks::allMasks[c][p.type()][src.idx()] & allowedTargets;
+        while(targets.any()) actions->push_back(Action::move(p, src, Pos(targets.popFirst())));
     }
-    else {
-        std::bitset<NB_PIECE_TYPE+1> typeVisited(false);
-        uint8_t dummyPos = 0;
-        for(uint8_t k = 0; k < reserve1.size; ++k) {
-            const Piece p = reserve1[k];
-            if(typeVisited[p.type()]) continue;
-            typeVisited[p.type()] = 1;
-            for(Pos::value i = 0; i < rows*cols; ++i) {
-                const Pos dst(i);
-                if(dst.valid() == false) continue;
-                if(allowedDrop(p, dummyPos, dst) == false) continue;
-                actions->push_back(Action::drop(p, dummyPos, dst));
-            }
+}
+
+void GameState::appendDrops(ActionSet* actions) const {
+    const Color c = currentPlayer;
+    const mask_t empty = board.empty();
+    if(!empty.any()) return;
+    for(uint8_t pt = Rook; pt <= Pawn; ++pt) {
+        const Piece p((PieceType)pt, c);
+        const bool available = (c == P0 ? reserve0.has(p.type()) : reserve1.has(p.type()));
+        if(!available) continue;
+        for(mask_t targets = empty; targets.any();) {
+            actions->push_back(Action::drop(p, Pos(targets.popFirst())));
         }
     }
-}
\ No newline at end of file
+}
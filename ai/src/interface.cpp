@@ -6,13 +6,23 @@
 #include "gamestate.h"
 #include "agent.h"
 #include "minimax/minimax.h"
+#include "minimax/engine.h"
+#include "minimax/lazysmp.h"
 #include "minimax/logger.h"
+#include "minimax/ponder.h"
 #include <cstring>
+#include <cctype>
 #include <ostream>
 #include <fstream>
 
 #define ENABLE_HUMAN_PLAYER 1
 
+// threads of the AI searches, set with --threads
+static unsigned int nbThreads = 1;
+
+// print the statistics of every AI search as a JSON line, set with --stats
+static bool printStats = false;
+
 #if ENABLE_HUMAN_PLAYER
 #include <iostream>
 
@@ -54,31 +64,14 @@ std::optional<Pos> readBoardPosition() {
         if(p.size() < 2) return std::nullopt;
         const char pc0 = p[0];
         const char pc1 = p[1];
-        if(pc0 == 'A' || pc0 == 'a') y = 0;
-        if(pc0 == 'B' || pc0 == 'b') y = 1;
-        if(pc0 == 'C' || pc0 == 'c') y = 2;
-        if(pc1 == '1') x = 3;
-        if(pc1 == '2') x = 2;
-        if(pc1 == '3') x = 1;
-        if(pc1 == '4') x = 0;
+        constexpr int rows = GameConfig::rows;
+        constexpr int cols = GameConfig::cols;
+        const int col = std::toupper(pc0) - 'A';
+        const int row = pc1 - '1';
+        if(col >= 0 && col < cols) y = col;
+        if(row >= 0 && row < rows) x = rows-1-row;
         if(x != -1 && y != -1) {
-            return std::make_optional(Pos(3*x+y));
-        }
-    } catch(...) {
-        return std::nullopt;
-    }
-    return std::nullopt;
-}
-
-std::optional<uint8_t> readReservePosition() {
-    std::string p;
-    int x = -1;
-    try {
-        std::cin >> p;
-        if(p.size() > 1) return std::nullopt;
-        x = std::atoi(p.c_str());
-        if(x != -1) {
-            return std::make_optional(x);
+            return std::make_optional(Pos(cols*x+y));
         }
     } catch(...) {
         return std::nullopt;
@@ -107,13 +100,10 @@ std::optional<Action> readAction(Color player) {
         std::optional<PieceType> piece = readPieceType();
         if(!piece) return std::nullopt;
 
-        std::optional<uint8_t> src = readReservePosition();
-        if(!src) return std::nullopt;
-
         std::optional<Pos> dst = readBoardPosition();
         if(!dst) return std::nullopt;
 
-        return std::make_optional(Action::drop(Piece(piece.value(), player), src.value(), dst.value()));
+        return std::make_optional(Action::drop(Piece(piece.value(), player), dst.value()));
     }
     return std::nullopt;
 }
@@ -143,15 +133,16 @@ void oneVsOne() {
     }
 }
 
+// With pondering, the AI searches the reply it expects while the human thinks.
 template<Mode mode>
-void oneVsAi(int depth) {
+void oneVsAi(int depth, bool pondering = false) {
     depth = std::max(0, std::min(20, depth));
 
-    GameHistory history;
-    GameState state(&history);
-    Agent agent;
-
-    using MyMinimax = Minimax<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    // the AI keeps its tables and the game from one move to the next
+    Engine<mode, Action, ActionSet, GameState, Agent, ActionOrdering> engine;
+    const GameState& state = engine.state;
+    Ponder<mode, Action, ActionSet, GameState, Agent, ActionOrdering> ponder(&engine.tt);
+    std::optional<Action> pondered;
 
     while(!state.gameOver()) {
         Logger::log(Verb::Std, [&]() { return state.niceToString(); });
@@ -166,16 +157,25 @@ void oneVsAi(int depth) {
                     Logger::log(Verb::Std, [&](){ return "invalid move"; });
                     continue;
                 }
-                bool success = state.apply(action.value());
+                pondered = ponder.hit(action.value());
+                bool success = engine.play(action.value());
                 Logger::log(Verb::Dev, [&](){ return "move success : " + std::to_string(success); });
             }
         } else {
             std::optional<Action> action;
-            MyMinimax search(state, agent);
-            search.run(depth);
-            action = search.bestAction;
+            std::optional<Action> reply;
+            if(pondered) {
+                Logger::log(Verb::Dev, [&](){ return "ponder hit"; });
+                action = pondered;
+                reply = ponder.reply;
+                pondered.reset();
+            } else {
+                action = engine.search(SearchLimits::fixedDepth(depth));
+                reply = engine.reply;
+            }
             if(action) {
-                state.apply(action.value());
+                engine.play(action.value());
+                if(pondering && reply && !state.gameOver()) ponder.start(state, *reply, engine.agent, SearchLimits::fixedDepth(depth));
             } else {
             Logger::log(Verb::Std, [&]() {
                 std::string s;
@@ -193,6 +193,20 @@ void oneVsAi(int depth) {
 
 
 
+// "Player A wins in N moves" when a search found the end of the game, empty otherwise
+std::string announcedEnd(Color player, score_t score) {
+    const int moves = Score::movesToEnd(score);
+    if(moves == 0) return "";
+    std::string s = "Player ";
+    s += (char)('A'+(int)player);
+    s += (moves > 0 ? " wins in " : " loses in ");
+    s += std::to_string(std::abs(moves));
+    s += (std::abs(moves) == 1 ? " move" : " moves");
+    return s;
+}
+
+// A positive game time (in milliseconds) gives the player a clock for the whole
+// game, and its depth is then only an upper bound.
 template<Mode mode>
 Color aivsAiFrom(
     Board b,
@@ -200,25 +214,39 @@ Color aivsAiFrom(
     Reserve<P1, GameConfig::ressize> r1,
     Color player,
     int depth0, 
-    int depth1) {
+    int depth1,
+    long long gameTime0 = 0,
+    long long gameTime1 = 0) {
 
     Logger::log(Verb::Dev, [&](){
         std::stringstream ss;
         ss << "Starting AIvAI mode with :\n";
         ss << " depths : " + std::to_string(depth0) + " vs " + std::to_string(depth1) << '\n';
-        ss << " mode   : " << (mode == Mode::PureMinimax ? "pure" : (mode == AlphaBeta ? "AlphaBeta" : "Iterative deepening")) << '\n';
+        ss << " mode   : " << (mode == Mode::PureMinimax ? "pure" : (mode == AlphaBeta ? "AlphaBeta" : (mode == IterativeDeepening ? "Iterative deepening" : (mode == PrincipalVariation ? "Principal variation" : (mode == MTDf ? "MTD(f)" : "Young brothers wait"))))) << '\n';
         return ss.str();
     });
 
     GameHistory history;
     GameState game(&history, b, r0, r1, player);
-    Agent agent0;
-    Agent agent1;
 
     depth0 = std::max(0, std::min(20, depth0));
     depth1 = std::max(0, std::min(20, depth1));
 
-    using MyMinimax = Minimax<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    // each player keeps its tables from one move to the next
+    using MyEngine = Engine<mode, Action, ActionSet, GameState, Agent, ActionOrdering>;
+    MyEngine engine0(nbThreads);
+    MyEngine engine1(nbThreads);
+    engine0.newGame(b, r0, r1, player);
+    engine1.newGame(b, r0, r1, player);
+    GameClock clock0(gameTime0);
+    GameClock clock1(gameTime1);
+
+    // limits of the next move of a player, from its depth or its clock
+    auto limitsFor = [&](int depth, long long gameTime, const GameClock& clock) {
+        if(gameTime <= 0) return SearchLimits::fixedDepth(depth);
+        const int movesLeft = (game.maxTurns - game.nbTurns + 1) / 2;
+        return clock.nextMove(movesLeft, depth);
+    };
 
     while(!game.gameOver()) {
         Logger::log(Verb::Std,
@@ -231,19 +259,30 @@ Color aivsAiFrom(
                 return s;
             });
         std::optional<Action> action;
+        score_t score = 0;
+        const Color player = game.currentPlayer;
         if(game.currentPlayer == P0) {
-            MyMinimax search0(game, agent0);
-            search0.run(depth0);
-            action = search0.bestAction;
+            clock0.start();
+            action = engine0.search(limitsFor(depth0, gameTime0, clock0));
+            score = engine0.score;
+            clock0.stop();
+            if(printStats) Logger::log(Verb::Std, [&]() { return engine0.stats.toJson(); });
         }
         if(game.currentPlayer == P1) {
-            MyMinimax search1(game, agent1);
-            search1.run(depth1);
-            action = search1.bestAction;
+            clock1.start();
+            action = engine1.search(limitsFor(depth1, gameTime1, clock1));
+            score = engine1.score;
+            clock1.stop();
+            if(printStats) Logger::log(Verb::Std, [&]() { return engine1.stats.toJson(); });
         }
         if(action) {
             Logger::log(Verb::Std, [&]() { return action.value().toString() + '\n'; });
+            if(Score::isDecided(score)) {
+                Logger::log(Verb::Std, [&]() { return announcedEnd(player, score) + '\n'; });
+            }
             game.apply(action.value());
+            engine0.play(action.value());
+            engine1.play(action.value());
         } else {
             Logger::log(Verb::Std, [&]() {
                 std::string s;
@@ -284,33 +323,31 @@ Color aivsAiFrom(
 
 
 template<Mode mode>
-Color aivsAi(int depth0, int depth1) {
+Color aivsAi(int depth0, int depth1, long long gameTime0 = 0, long long gameTime1 = 0) {
     Board b;
     Reserve<P0, GameConfig::ressize> r0;
     Reserve<P1, GameConfig::ressize> r1;
     Color player = Color::P0;
-    return aivsAiFrom<mode>(b, r0, r1, player, depth0, depth1);
+    return aivsAiFrom<mode>(b, r0, r1, player, depth0, depth1, gameTime0, gameTime1);
 }
 
 template<typename Func>
 void enumeratePositionsHelper(
                             unsigned int maxdepth,
-                            GameState root,
+                            GameState& root,
                             std::ostream& ostream,
                             Func runner) {
     if(maxdepth == 0) return;
     ActionSet actions;
     root.fillAllowedActions(&actions);
     for(Action a : actions) {
-        GameState node = root;
-        node.apply(a);
-        if(node.hasWinner()) continue;
-
-        runner(node, ostream);
-
-        
-
-        enumeratePositionsHelper(maxdepth-1, node, ostream, runner);
+        GameState::Undo undo;
+        root.apply(a, undo);
+        if(!root.hasWinner()) {
+            runner(root, ostream);
+            enumeratePositionsHelper(maxdepth-1, root, ostream, runner);
+        }
+        root.undo(undo);
     }
 }
 
@@ -344,9 +381,22 @@ void enumeratePositions(unsigned int maxdepth, std::string filename) {
 }
 
 int main(int argc, char** argv) {
+    while(argc >= 2) {
+        if(argc >= 3 && std::strcmp(argv[1], "--threads") == 0) {
+            nbThreads = std::max(1, std::atoi(argv[2]));
+            argc -= 2;
+            argv += 2;
+        } else if(std::strcmp(argv[1], "--stats") == 0) {
+            printStats = true;
+            argc -= 1;
+            argv += 1;
+        } else {
+            break;
+        }
+    }
     if(argc <= 1) {
         Logger::log(Verb::Std, []() {
-            return "Available game modes : --1v1, --1vAI, --AIvAI";
+            return "Available game modes : --1v1, --1vAI, --AIvAI, --AIvAItimed\nAI searches use more threads with : exe --threads N mode ...\nAI searches print their statistics as JSON with : exe --stats mode ...";
         });
         return 0;
     }
@@ -360,7 +410,7 @@ int main(int argc, char** argv) {
     if(std::strcmp(argv[1], "--1vAI") == 0) {
         if(argc <= 2) {
             Logger::log(Verb::Std, [](){
-                return "Usage : exe 1vAI depth";
+                return "Usage : exe 1vAI depth [ponder]";
             });
             return 0;
         }
@@ -369,8 +419,10 @@ int main(int argc, char** argv) {
             return "Starting 1vAI mode vs depth : " + std::to_string(depth);
         });
 
+        const bool pondering = (argc >= 4 && std::strcmp(argv[3], "ponder") == 0);
+
         // oneVsAi<PureMinimax>(depth);
-        oneVsAi<AlphaBeta>(depth);
+        oneVsAi<AlphaBeta>(depth, pondering);
     }
 #endif
     if(std::strcmp(argv[1], "--enumerate") == 0) {
@@ -395,7 +447,7 @@ int main(int argc, char** argv) {
     if(std::strcmp(argv[1], "--AIvAI") == 0) {
         if(argc <= 3) {
             Logger::log(Verb::Std, [](){
-                return "Usage : exe --AIvAI depth0 depth1 [mode = pure|alphabeta|iterdeepen]";
+                return "Usage : exe --AIvAI depth0 depth1 [mode = pure|alphabeta|iterdeepen|pvs|mtdf|ybwc]";
             });
             return 0;
         }
@@ -407,6 +459,7 @@ int main(int argc, char** argv) {
             ss << " depths : " + std::to_string(d0) + " vs " + std::to_string(d1) << '\n';
             ss << " mode   : " << (argc <= 4 ? "pure" : argv[4]) << '\n';
             ss << " config : " << (argc <= 5 ? "easy" : argv[5]) << '\n';
+            ss << " threads: " << nbThreads << '\n';
             return ss.str();
         });
         if(argc >= 5 && std::strcmp(argv[4], "alphabeta") == 0) {
@@ -421,6 +474,24 @@ int main(int argc, char** argv) {
                 return 0;
             }
         }
+        if(argc >= 5 && std::strcmp(argv[4], "pvs") == 0) {
+            if(argc < 6 || (argc == 6 && std::strcmp(argv[5], "easy") == 0)) {
+                aivsAi<PrincipalVariation>(d0, d1);
+                return 0;
+            }
+        }
+        if(argc >= 5 && std::strcmp(argv[4], "mtdf") == 0) {
+            if(argc < 6 || (argc == 6 && std::strcmp(argv[5], "easy") == 0)) {
+                aivsAi<MTDf>(d0, d1);
+                return 0;
+            }
+        }
+        if(argc >= 5 && std::strcmp(argv[4], "ybwc") == 0) {
+            if(argc < 6 || (argc == 6 && std::strcmp(argv[5], "easy") == 0)) {
+                aivsAi<YoungBrothers>(d0, d1);
+                return 0;
+            }
+        }
         if(argc >= 4 || (argc == 5 && std::strcmp(argv[4], "pure") == 0)) {
             if(argc < 6 || (argc == 6 && std::strcmp(argv[5], "easy") == 0)) {
                 aivsAi<PureMinimax>(d0, d1);
@@ -428,6 +499,35 @@ int main(int argc, char** argv) {
             }
         }
     }
+    if(std::strcmp(argv[1], "--AIvAItimed") == 0) {
+        if(argc <= 3) {
+            Logger::log(Verb::Std, [](){
+                return "Usage : exe --AIvAItimed time0 time1 [mode = iterdeepen|pvs|mtdf]\ntimes are in milliseconds for the whole game";
+            });
+            return 0;
+        }
+        long long t0 = std::atoll(argv[2]);
+        long long t1 = std::atoll(argv[3]);
+        const int maxDepth = 20;
+        Logger::log(Verb::Std, [&](){
+            std::stringstream ss;
+            ss << "Starting timed AIvAI mode with :\n";
+            ss << " times  : " + std::to_string(t0) + "ms vs " + std::to_string(t1) << "ms\n";
+            ss << " mode   : " << (argc <= 4 ? "pvs" : argv[4]) << '\n';
+            ss << " threads: " << nbThreads << '\n';
+            return ss.str();
+        });
+        if(argc >= 5 && std::strcmp(argv[4], "iterdeepen") == 0) {
+            aivsAi<IterativeDeepening>(maxDepth, maxDepth, t0, t1);
+            return 0;
+        }
+        if(argc >= 5 && std::strcmp(argv[4], "mtdf") == 0) {
+            aivsAi<MTDf>(maxDepth, maxDepth, t0, t1);
+            return 0;
+        }
+        aivsAi<PrincipalVariation>(maxDepth, maxDepth, t0, t1);
+        return 0;
+    }
     if(argc >= 1 && std::strcmp(argv[1], "--interactive") == 0) {
         if(argc <= 6) {
             Logger::log(Verb::Std, [](){
@@ -436,16 +536,16 @@ int main(int argc, char** argv) {
             return 0;
         }
 
-        if(std::strlen(argv[2]) != 12) {
-            Logger::log(Verb::Std, []() { return "invalid board : must have 12 characters"; });
+        if(std::strlen(argv[2]) != GameConfig::squares) {
+            Logger::log(Verb::Std, []() { return "invalid board : must have " + std::to_string(GameConfig::squares) + " characters"; });
         }
 
-        if(std::strlen(argv[3]) > 7) {
-            Logger::log(Verb::Std, []() { return "invalid reserve 1 : cannot have more than 7 pieces"; });
+        if(std::strlen(argv[3]) > GameConfig::ressize) {
+            Logger::log(Verb::Std, []() { return "invalid reserve 1 : cannot have more than " + std::to_string(GameConfig::ressize) + " pieces"; });
         }
 
-        if(std::strlen(argv[4]) > 7) {
-            Logger::log(Verb::Std, []() { return "invalid reserve 2 : cannot have more than 7 pieces"; });
+        if(std::strlen(argv[4]) > GameConfig::ressize) {
+            Logger::log(Verb::Std, []() { return "invalid reserve 2 : cannot have more than " + std::to_string(GameConfig::ressize) + " pieces"; });
         }
 
         if (std::strlen(argv[5]) > 1) {
@@ -476,12 +576,18 @@ int main(int argc, char** argv) {
         Agent agent;
         using MyMinimax = Minimax<Mode::AlphaBeta, Action, ActionSet, GameState, Agent, ActionOrdering>;
 
+        MyMinimax::TT tt;
+
         std::optional<Action> action;
-        MyMinimax search(state, agent);
-        search.run(depth);
+        MyMinimax search(state, agent, &tt);
+        const score_t score = search.run(depth);
         action = search.bestAction;
+        if(printStats) Logger::log(Verb::Std, [&]() { return search.stats.toJson(); });
         if(action) {
             Logger::log(Verb::Std, [&](){ return action->toString(); });
+            if(Score::isDecided(score)) {
+                Logger::log(Verb::Std, [&](){ return announcedEnd(player, score); });
+            }
             state.apply(action.value());
         } else {
             Logger::log(Verb::Std, [&]() {
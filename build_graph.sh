@@ -1,2 +1,2 @@
 cd graph
-clang++-11 src/*.cpp -Iinclude -Ilib/include -std=c++2a -O3 -march=native -DNDEBUG -g
+clang++-11 src/*.cpp -Iinclude -Ilib/include -I../common/include -std=c++2a -O3 -march=native -DNDEBUG -g
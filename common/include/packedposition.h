@@ -0,0 +1,117 @@
+#ifndef PACKEDPOSITION_H
+#define PACKEDPOSITION_H
+
+#include <array>
+#include <cstdint>
+
+// Position encoding shared by the ai engine and the graph explorer.
+// A whole position fits in a single 64-bit integer :
+// bits  0..47 : 12 squares, 4 bits each, square 0 in the lowest nibble
+// bits 48..54 : reserve of player 0 (King:1, Rook:2, Bishop:2, Pawn:2)
+// bits 55..61 : reserve of player 1 (King:1, Rook:2, Bishop:2, Pawn:2)
+// bit  62     : side to move
+
+struct UnpackedPosition {
+
+    // piece codes : 0 is an empty square, otherwise color | (type << 1)
+    // with types King = 1, Rook = 2, Bishop = 3, Pawn = 4, Queen = 5
+    std::array<uint8_t, 12> board;
+
+    // reserves[player][type] : number of pieces of that type in the reserve of player
+    // indexed by the same types as the piece codes, only King, Rook, Bishop and Pawn are stored
+    std::array<std::array<uint8_t, 6>, 2> reserves;
+
+    uint8_t player;
+
+    constexpr bool operator==(const UnpackedPosition& other) const {
+        return board == other.board && reserves == other.reserves && player == other.player;
+    }
+};
+
+struct PackedPosition {
+
+    using value_t = uint64_t;
+
+    static constexpr unsigned int squares = 12;
+    static constexpr unsigned int bitsPerSquare = 4;
+    static constexpr unsigned int reserveOffset = squares*bitsPerSquare;
+    static constexpr unsigned int reserveBits = 7;
+    static constexpr unsigned int playerOffset = reserveOffset + 2*reserveBits;
+
+    static constexpr uint8_t King = 1;
+    static constexpr uint8_t Rook = 2;
+    static constexpr uint8_t Bishop = 3;
+    static constexpr uint8_t Pawn = 4;
+
+    value_t value;
+
+    constexpr uint8_t square(unsigned int pos) const {
+        return (value >> (bitsPerSquare*pos)) & 0xF;
+    }
+
+    constexpr uint8_t reserve(unsigned int player, uint8_t type) const {
+        const value_t res = value >> (reserveOffset + player*reserveBits);
+        switch(type) {
+            case King:   return res & 0x1;
+            case Rook:   return (res >> 1) & 0x3;
+            case Bishop: return (res >> 3) & 0x3;
+            case Pawn:   return (res >> 5) & 0x3;
+        }
+        return 0;
+    }
+
+    constexpr uint8_t player() const {
+        return (value >> playerOffset) & 0x1;
+    }
+
+    constexpr bool operator==(PackedPosition other) const { return value == other.value; }
+    constexpr bool operator<(PackedPosition other) const { return value < other.value; }
+
+    static constexpr PackedPosition pack(const UnpackedPosition& pos) {
+        value_t v = 0;
+        for(unsigned int i = 0; i < squares; ++i) {
+            v |= value_t(pos.board[i] & 0xF) << (bitsPerSquare*i);
+        }
+        for(unsigned int p = 0; p < 2; ++p) {
+            const auto& res = pos.reserves[p];
+            value_t r = 0;
+            r |= value_t(res[King] & 0x1);
+            r |= value_t(res[Rook] & 0x3) << 1;
+            r |= value_t(res[Bishop] & 0x3) << 3;
+            r |= value_t(res[Pawn] & 0x3) << 5;
+            v |= r << (reserveOffset + p*reserveBits);
+        }
+        v |= value_t(pos.player & 0x1) << playerOffset;
+        return PackedPosition{v};
+    }
+
+    static constexpr UnpackedPosition unpack(PackedPosition packed) {
+        UnpackedPosition pos {};
+        for(unsigned int i = 0; i < squares; ++i) pos.board[i] = packed.square(i);
+        for(unsigned int p = 0; p < 2; ++p) {
+            for(uint8_t type = King; type <= Pawn; ++type) pos.reserves[p][type] = packed.reserve(p, type);
+        }
+        pos.player = packed.player();
+        return pos;
+    }
+
+    constexpr UnpackedPosition unpack() const { return unpack(*this); }
+
+};
+
+static_assert(sizeof(PackedPosition) == 8);
+static_assert(PackedPosition::playerOffset < 64);
+
+namespace {
+
+    constexpr UnpackedPosition packingExample {
+        { { 6, 2, 4, 0, 8, 0, 0, 9, 0, 5, 3, 7 } },
+        { { { 0, 0, 2, 1, 2, 0 }, { 0, 1, 0, 2, 0, 0 } } },
+        1
+    };
+
+    static_assert(PackedPosition::unpack(PackedPosition::pack(packingExample)) == packingExample);
+
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include "packedposition.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+// Dense indexing of game positions : every position with the full material
+// (two kings, two rooks, two bishops, two pawns) and at most one captured king
+// maps to a unique integer in [0, size) and back.
+//
+// index = player * sideSize + kingOffset(kings) + compositionOffset + boardRank
+//  - kings       : both kings on the board (12*11 placements) or one king captured
+//                  and held in the opponent's reserve (2*12 placements)
+//  - composition : how many rooks, bishops and pawns each reserve holds,
+//                  the remaining ones are on the board
+//  - boardRank   : which of the free squares hold a piece, the type, color and
+//                  promotion of each of them
+
+// Counting helpers, kept outside PositionIndex so that its tables can be
+// computed at compile time.
+namespace PositionCounting {
+
+    using index_t = uint64_t;
+
+    constexpr unsigned int squares = PackedPosition::squares;
+    constexpr unsigned int nbTypes = 3; // Rook, Bishop, Pawn
+    constexpr unsigned int perType = 2;
+    constexpr unsigned int nbSplits = 6; // (in reserve 0, in reserve 1) with sum <= perType
+    constexpr unsigned int nbCompositions = nbSplits*nbSplits*nbSplits;
+
+    constexpr unsigned int kingsOnBoard = squares*(squares-1);
+    constexpr unsigned int kingPlacements = kingsOnBoard + 2*squares;
+
+    constexpr uint8_t typeCode(unsigned int t) { return PackedPosition::Rook + t; }
+
+    constexpr index_t binomial(unsigned int n, unsigned int k) {
+        if(k > n) return 0;
+        index_t r = 1;
+        for(unsigned int i = 1; i <= k; ++i) r = r * (n-k+i) / i;
+        return r;
+    }
+
+    constexpr index_t multinomial(const std::array<unsigned int, nbTypes>& counts) {
+        index_t r = 1;
+        unsigned int n = 0;
+        for(unsigned int c : counts) {
+            n += c;
+            r *= binomial(n, c);
+        }
+        return r;
+    }
+
+    // (a, b) with a + b <= perType, in lexicographic order
+    constexpr unsigned int splitIndex(unsigned int a, unsigned int b) {
+        return a*(2*perType+3-a)/2 + b;
+    }
+
+    struct Composition {
+        std::array<unsigned int, nbTypes> reserve0;
+        std::array<unsigned int, nbTypes> reserve1;
+        std::array<unsigned int, nbTypes> onBoard;
+        unsigned int nbOnBoard;
+        unsigned int nbPawns;
+    };
+
+    constexpr Composition composition(unsigned int comp) {
+        Composition c {};
+        for(unsigned int t = nbTypes; t --> 0;) {
+            unsigned int split = comp % nbSplits;
+            comp /= nbSplits;
+            unsigned int a = 0;
+            while(split > perType-a) {
+                split -= perType-a+1;
+                ++a;
+            }
+            c.reserve0[t] = a;
+            c.reserve1[t] = split;
+            c.onBoard[t] = perType - a - split;
+            c.nbOnBoard += c.onBoard[t];
+        }
+        c.nbPawns = c.onBoard[nbTypes-1];
+        return c;
+    }
+
+    constexpr index_t boardCount(unsigned int freeSquares, const Composition& c) {
+        return binomial(freeSquares, c.nbOnBoard) * multinomial(c.onBoard) << (c.nbOnBoard + c.nbPawns);
+    }
+
+    // offsets of each composition, for 10 or 11 free squares
+    struct Tables {
+        std::array<std::array<index_t, nbCompositions+1>, 2> compositionOffset;
+        index_t sideSize;
+    };
+
+    constexpr Tables computeTables() {
+        Tables tables {};
+        for(unsigned int f = 0; f < 2; ++f) {
+            index_t offset = 0;
+            for(unsigned int comp = 0; comp < nbCompositions; ++comp) {
+                tables.compositionOffset[f][comp] = offset;
+                offset += boardCount(squares-2+f, composition(comp));
+            }
+            tables.compositionOffset[f][nbCompositions] = offset;
+        }
+        tables.sideSize = kingsOnBoard*tables.compositionOffset[0][nbCompositions]
+            + 2*squares*tables.compositionOffset[1][nbCompositions];
+        return tables;
+    }
+
+}
+
+struct PositionIndex {
+
+    using index_t = PositionCounting::index_t;
+    using Composition = PositionCounting::Composition;
+
+    static constexpr unsigned int squares = PositionCounting::squares;
+    static constexpr unsigned int nbTypes = PositionCounting::nbTypes;
+    static constexpr unsigned int perType = PositionCounting::perType;
+    static constexpr unsigned int nbSplits = PositionCounting::nbSplits;
+    static constexpr unsigned int nbCompositions = PositionCounting::nbCompositions;
+    static constexpr unsigned int kingsOnBoard = PositionCounting::kingsOnBoard;
+    static constexpr unsigned int kingPlacements = PositionCounting::kingPlacements;
+
+    static constexpr PositionCounting::Tables tables = PositionCounting::computeTables();
+
+    static constexpr index_t blockSize(unsigned int f) { return tables.compositionOffset[f][nbCompositions]; }
+
+    static constexpr index_t kingOffset(unsigned int kings) {
+        if(kings < kingsOnBoard) return kings*blockSize(0);
+        return kingsOnBoard*blockSize(0) + (kings-kingsOnBoard)*blockSize(1);
+    }
+
+    static constexpr index_t size = 2*tables.sideSize;
+
+    static constexpr index_t rank(PackedPosition packed) {
+        const UnpackedPosition pos = packed.unpack();
+        const uint8_t king0 = PackedPosition::King << 1;
+        const uint8_t king1 = king0 | 1;
+
+        int kingSquare0 = -1;
+        int kingSquare1 = -1;
+        for(unsigned int i = 0; i < squares; ++i) {
+            if(pos.board[i] == king0) kingSquare0 = i;
+            if(pos.board[i] == king1) kingSquare1 = i;
+        }
+
+        unsigned int kings = 0;
+        if(kingSquare0 >= 0 && kingSquare1 >= 0) {
+            kings = kingSquare0*(squares-1) + kingSquare1 - (kingSquare1 > kingSquare0);
+        } else if(kingSquare1 >= 0) {
+            assert(pos.reserves[1][PackedPosition::King] == 1);
+            kings = kingsOnBoard + kingSquare1;
+        } else {
+            assert(kingSquare0 >= 0);
+            assert(pos.reserves[0][PackedPosition::King] == 1);
+            kings = kingsOnBoard + squares + kingSquare0;
+        }
+        const unsigned int f = (kings < kingsOnBoard ? 0 : 1);
+
+        unsigned int comp = 0;
+        std::array<unsigned int, nbTypes> remaining {};
+        for(unsigned int t = 0; t < nbTypes; ++t) {
+            const uint8_t type = PositionCounting::typeCode(t);
+            const unsigned int a = pos.reserves[0][type];
+            const unsigned int b = pos.reserves[1][type];
+            assert(a + b <= perType);
+            comp = comp*nbSplits + PositionCounting::splitIndex(a, b);
+            remaining[t] = perType - a - b;
+        }
+        const Composition c = PositionCounting::composition(comp);
+
+        index_t subset = 0;
+        index_t types = 0;
+        index_t colors = 0;
+        index_t promotions = 0;
+        unsigned int n = 0;
+        unsigned int freeSquare = 0;
+        for(unsigned int i = 0; i < squares; ++i) {
+            const uint8_t code = pos.board[i];
+            if(code == king0 || code == king1) continue;
+            if(code != 0) {
+                const uint8_t type = code >> 1;
+                const unsigned int t = (type == PackedPosition::Pawn + 1 ? nbTypes-1 : type - PackedPosition::Rook);
+                assert(t < nbTypes && remaining[t] > 0);
+                subset += PositionCounting::binomial(freeSquare, n+1);
+                for(unsigned int u = 0; u < t; ++u) {
+                    if(remaining[u] == 0) continue;
+                    --remaining[u];
+                    types += PositionCounting::multinomial(remaining);
+                    ++remaining[u];
+                }
+                --remaining[t];
+                colors = (colors << 1) | (code & 1);
+                if(t == nbTypes-1) promotions = (promotions << 1) | (type != PackedPosition::Pawn);
+                ++n;
+            }
+            ++freeSquare;
+        }
+        assert(n == c.nbOnBoard);
+
+        const index_t boardRank = (((subset * PositionCounting::multinomial(c.onBoard) + types) << c.nbOnBoard | colors) << c.nbPawns) | promotions;
+        return packed.player() * tables.sideSize + kingOffset(kings) + tables.compositionOffset[f][comp] + boardRank;
+    }
+
+    static constexpr PackedPosition unrank(index_t index) {
+        assert(index < size);
+        UnpackedPosition pos {};
+        pos.player = index / tables.sideSize;
+        index %= tables.sideSize;
+
+        unsigned int kings = 0;
+        if(index < kingsOnBoard*blockSize(0)) {
+            kings = index / blockSize(0);
+        } else {
+            kings = kingsOnBoard + (index - kingsOnBoard*blockSize(0)) / blockSize(1);
+        }
+        index -= kingOffset(kings);
+        const unsigned int f = (kings < kingsOnBoard ? 0 : 1);
+
+        const uint8_t king0 = PackedPosition::King << 1;
+        const uint8_t king1 = king0 | 1;
+        std::array<bool, squares> isKing {};
+        if(kings < kingsOnBoard) {
+            const unsigned int k0 = kings / (squares-1);
+            const unsigned int j = kings % (squares-1);
+            const unsigned int k1 = (j < k0 ? j : j+1);
+            pos.board[k0] = king0;
+            pos.board[k1] = king1;
+            isKing[k0] = isKing[k1] = true;
+        } else if(kings < kingsOnBoard + squares) {
+            const unsigned int k1 = kings - kingsOnBoard;
+            pos.board[k1] = king1;
+            isKing[k1] = true;
+            pos.reserves[1][PackedPosition::King] = 1;
+        } else {
+            const unsigned int k0 = kings - kingsOnBoard - squares;
+            pos.board[k0] = king0;
+            isKing[k0] = true;
+            pos.reserves[0][PackedPosition::King] = 1;
+        }
+
+        unsigned int comp = 0;
+        while(tables.compositionOffset[f][comp+1] <= index) ++comp;
+        index -= tables.compositionOffset[f][comp];
+        const Composition c = PositionCounting::composition(comp);
+        for(unsigned int t = 0; t < nbTypes; ++t) {
+            pos.reserves[0][PositionCounting::typeCode(t)] = c.reserve0[t];
+            pos.reserves[1][PositionCounting::typeCode(t)] = c.reserve1[t];
+        }
+
+        const unsigned int n = c.nbOnBoard;
+        const index_t promotions = index & ((index_t(1) << c.nbPawns) - 1);
+        index >>= c.nbPawns;
+        const index_t colors = index & ((index_t(1) << n) - 1);
+        index >>= n;
+        index_t types = index % PositionCounting::multinomial(c.onBoard);
+        index_t subset = index / PositionCounting::multinomial(c.onBoard);
+
+        std::array<unsigned int, squares> chosen {};
+        unsigned int freeSquare = squares - 2 + f;
+        for(unsigned int i = n; i > 0; --i) {
+            do { --freeSquare; } while(PositionCounting::binomial(freeSquare, i) > subset);
+            subset -= PositionCounting::binomial(freeSquare, i);
+            chosen[i-1] = freeSquare;
+        }
+
+        std::array<unsigned int, nbTypes> remaining = c.onBoard;
+        unsigned int nbPawnsSeen = 0;
+        unsigned int next = 0;
+        unsigned int square = 0;
+        for(unsigned int i = 0; i < n; ++i) {
+            unsigned int t = 0;
+            for(;; ++t) {
+                if(remaining[t] == 0) continue;
+                --remaining[t];
+                const index_t m = PositionCounting::multinomial(remaining);
+                if(types < m) break;
+                types -= m;
+                ++remaining[t];
+            }
+            while(true) {
+                if(!isKing[square]) {
+                    if(next == chosen[i]) break;
+                    ++next;
+                }
+                ++square;
+            }
+            uint8_t type = PositionCounting::typeCode(t);
+            if(t == nbTypes-1) {
+                type += (promotions >> (c.nbPawns - 1 - nbPawnsSeen)) & 1;
+                ++nbPawnsSeen;
+            }
+            const uint8_t color = (colors >> (n - 1 - i)) & 1;
+            pos.board[square] = (type << 1) | color;
+        }
+
+        return PackedPosition::pack(pos);
+    }
+
+};
+
+static_assert(PositionIndex::size < (PositionIndex::index_t(1) << 32), "position indices fit in 32 bits");
+
+#endif
@@ -3,12 +3,14 @@
 
 #include "piece.h"
 #include "moves/allowedmove.h"
+#include "packedposition.h"
+#include "positionindex.h"
 #include <array>
 #include <string_view>
 #include <string>
 #include <deque>
 
-// TODO : memory footprint can be divided by 2 : Piece fits on a half byte
+// A Node can be stored in 8 bytes through pack() : see packedposition.h
 
 struct Node {
     using reserve_t = std::array<Piece, 7>;
@@ -56,6 +58,52 @@ struct Node {
         age = 0;
     }
 
+    Node(PackedPosition packed, short age = 0) : age(age) {
+        const UnpackedPosition pos = packed.unpack();
+        for(int i = 0; i < 12; ++i) board[i] = pieceOfPackedCode(pos.board[i]);
+        auto fillReserve = [](reserve_t& res, const std::array<uint8_t, 6>& counts, bool player) {
+            std::fill(res.begin(), res.end(), Piece::E);
+            size_t pos = 0;
+            for(uint8_t type = PackedPosition::King; type <= PackedPosition::Pawn; ++type) {
+                for(uint8_t n = 0; n < counts[type]; ++n) res[pos++] = pieceOfPackedCode(player | (type << 1));
+            }
+            std::sort(res.begin(), res.end());
+        };
+        fillReserve(res0, pos.reserves[0], 0);
+        fillReserve(res1, pos.reserves[1], 1);
+        player = pos.player;
+    }
+
+    PackedPosition pack() const {
+        UnpackedPosition pos {};
+        for(int i = 0; i < 12; ++i) pos.board[i] = packedCodeOf(board[i]);
+        // reserves only hold King, Rook, Bishop and Pawn, which are the types packed
+        for(Piece p : res0) if(!isEmpty(p)) { assert(!isQueen(p)); ++pos.reserves[0][packedCodeOf(p) >> 1]; }
+        for(Piece p : res1) if(!isEmpty(p)) { assert(!isQueen(p)); ++pos.reserves[1][packedCodeOf(p) >> 1]; }
+        pos.player = player;
+        return PackedPosition::pack(pos);
+    }
+
+    // packed key shared by a node and its left-right mirror
+    PackedPosition::value_t key() const {
+        const PackedPosition p = pack();
+        PackedPosition::value_t mirrored = p.value;
+        for(int i = 0; i < 4; ++i) {
+            const unsigned int left = 4*(3*i+0);
+            const unsigned int right = 4*(3*i+2);
+            const PackedPosition::value_t l = (p.value >> left) & 0xF;
+            const PackedPosition::value_t r = (p.value >> right) & 0xF;
+            mirrored &= ~((PackedPosition::value_t(0xF) << left) | (PackedPosition::value_t(0xF) << right));
+            mirrored |= (l << right) | (r << left);
+        }
+        return std::min(p.value, mirrored);
+    }
+
+    // dense index of key(), see positionindex.h
+    PositionIndex::index_t index() const {
+        return PositionIndex::rank(PackedPosition{key()});
+    }
+
     std::string toString() const {
         std::string s;
         s.reserve(7+1+12+1+7+1+1);
@@ -108,7 +156,7 @@ struct Node {
                         if(isPlayer1(q) && !isKing(q)) {
                             reserve_t newres = res0;
                             assert(isEmpty(res0[6]));
-                            newres[6] = swapColor(q);
+                            newres[6] = swapColor(demoted(q));
                             std::sort(newres.begin(), newres.end());
                             board_t newboard = board;
                             newboard[dst] = p;
@@ -157,7 +205,7 @@ struct Node {
                         if(isPlayer0(q) && !isKing(q)) {
                             reserve_t newres = res1;
                             assert(isEmpty(res1[6]));
-                            newres[6] = swapColor(q);
+                            newres[6] = swapColor(demoted(q));
                             std::sort(newres.begin(), newres.end());
                             board_t newboard = board;
                             newboard[dst] = p;
@@ -61,11 +61,11 @@ struct PosTracker {
 };
 
 struct TrivialTracker {
-    std::unordered_set<size_t> hashes;
+    std::unordered_set<PackedPosition::value_t> hashes;
 
-    bool contains(const Node& node) const { return hashes.contains(node.hash()); }
+    bool contains(const Node& node) const { return hashes.contains(node.key()); }
 
-    void push(const Node& node) { hashes.insert(node.hash()); }
+    void push(const Node& node) { hashes.insert(node.key()); }
 
     size_t count() const { return hashes.size(); }
 
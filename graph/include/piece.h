@@ -3,6 +3,7 @@
 
 #include <string_view>
 #include <cassert>
+#include <cstdint>
 
 static constexpr const char* PieceCode = "KkPpBbRrQq.";
 
@@ -38,6 +39,21 @@ constexpr char charOf(Piece p) {
     return PieceCode[static_cast<char>(p)];
 }
 
+// piece codes of the shared PackedPosition encoding : color | (type << 1)
+static constexpr uint8_t PackedCode[11] = { 2, 3, 8, 9, 6, 7, 4, 5, 10, 11, 0 };
+
+constexpr uint8_t packedCodeOf(Piece p) {
+    return PackedCode[static_cast<char>(p)];
+}
+
+constexpr Piece pieceOfPackedCode(uint8_t code) {
+    for(char p = 0; p < 11; ++p) {
+        if(PackedCode[p] == code) return static_cast<Piece>(p);
+    }
+    assert(false);
+    return Piece::E;
+}
+
 constexpr bool isKing(Piece p)    { return p == Piece::K || p == Piece::k; }
 constexpr bool isPawn(Piece p)    { return p == Piece::P || p == Piece::p; }
 constexpr bool isBishop(Piece p)  { return p == Piece::B || p == Piece::b; }
@@ -46,9 +62,13 @@ constexpr bool isQueen(Piece p)   { return p == Piece::Q || p == Piece::q; }
 constexpr bool isEmpty(Piece p)   { return p == Piece::E; }
 constexpr bool isPlayer0(Piece p) { return p == Piece::K || p == Piece::P || p == Piece::B || p == Piece::R || p == Piece::Q; }
 constexpr bool isPlayer1(Piece p) { return p == Piece::k || p == Piece::p || p == Piece::b || p == Piece::r || p == Piece::q; }
+// a captured Queen goes back to its owner's reserve as a Pawn
+constexpr Piece demoted(Piece p) {
+    if(p == Piece::Q) return Piece::P;
+    if(p == Piece::q) return Piece::p;
+    return p;
+}
 constexpr Piece swapColor(Piece p) {
-    if(p == Piece::Q) p = Piece::P;
-    if(p == Piece::q) p = Piece::p;
     char c = static_cast<char>(p); return isEmpty(p) ? p : static_cast<Piece>(c&1 ? c-1 : c+1);
 }
 
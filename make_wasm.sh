@@ -1,9 +1,11 @@
 cd ai
-~/git/emsdk/upstream/emscripten/em++ src/*.cpp -Iinclude -Ilib/include\
+~/git/emsdk/upstream/emscripten/em++ src/*.cpp -Iinclude -Ilib/include -I../common/include\
     -std=c++2a -O3 -march=native -DNDEBUG\
     -o ../web/js/yokai/yokai-lib.js\
     -s SINGLE_FILE\
     -s WASM=1\
-    -s EXPORTED_FUNCTIONS='["_validAction", "_playAction", "_searchBestMove", "_board", "_reserve0", "_reserve1", "_init"]'\
+    -s EXPORTED_FUNCTIONS='["_validAction", "_playAction", "_searchBestMove", "_searchBestMoveMTDf", "_searchBestMoveTimed", "_searchMovesToEnd", "_newGame", "_board", "_reserve0", "_reserve1", "_init"]'\
     -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap"]'\
+    -s INITIAL_MEMORY=67108864\
+    -s ALLOW_MEMORY_GROWTH\
     -s MODULARIZE\
@@ -9,6 +9,7 @@ class Yokai {
         this.currentPlayer = player;
         this.apiSearchBestMove = WasmModule.cwrap('searchBestMove', 'number', ['string', 'string', 'string', 'number', 'number'])
         this.apiInit = WasmModule.cwrap('init', 'void', [])
+        this.apiNewGame = WasmModule.cwrap('newGame', 'void', [])
         this.apiBoard = WasmModule.cwrap('board', 'string', [])
         this.apiReserve0 = WasmModule.cwrap('reserve0', 'string', [])
         this.apiReserve1 = WasmModule.cwrap('reserve1', 'string', [])
@@ -79,13 +80,18 @@ class Yokai {
         return fen
     }
 
+    // returns false when the AI has no move : the game it follows is over, drawn by
+    // repetition or by the number of turns since no king was captured
     autoMove(depth) {
         var t0 = performance.now()
-        this.searchBestMove(depth)
+        const moved = this.searchBestMove(depth)
         var t1 = performance.now()
         console.log("AutoMove took " + (t1 - t0) + " milliseconds.")
-        this.update()
-        this.swapPlayer()
+        if(moved) {
+            this.update()
+            this.swapPlayer()
+        }
+        return moved != 0
     }
 
     moveToAction(move) {
@@ -149,8 +155,8 @@ class Yokai {
     }
 
     winner() {
-        if(this.reserve0.length > 0 && this.reserve0[this.reserve0.length-1] == 'K') return 0;
-        if(this.reserve1.length > 0 && this.reserve1[this.reserve1.length-1] == 'k') return 1;
+        if(this.reserve0.includes('K')) return 0;
+        if(this.reserve1.includes('k')) return 1;
         return -1;
     }
 
@@ -164,8 +170,10 @@ class Yokai {
 
     // Low level api
 
+    // the AI keeps what it learned during a game, each Yokai starts a new one
     initInternal() {
         this.apiInit();
+        this.apiNewGame();
     }
 
     validAction(action, piece, start, end) {